@@ -0,0 +1,103 @@
+#!/bin/sh
+# Benchmark matrix of the buffer engines on the host build: every engine x producer/consumer
+# count x BUFFER_SIZE x batch size (PRODUCER_BATCH_SIZE = CONSUMER_BATCH_SIZE) is built and
+# run, and its throughput and item latency percentiles are written as CSV (and JSON).
+#
+#   ./bench.sh [-b pc_sim|pc_host] [-t run_ms] [-o results.csv] [-j results.json]
+#
+#   -b  backend: pc_sim (default - virtual time, so a rerun of the same tree gives the same
+#       figures) or pc_host (real threads and time - scheduling noise, but real CPU costs);
+#   -t  run length per configuration in ms (default 1000);
+#   -o  CSV file (default: standard output); -j  also write the results as JSON.
+#
+# The matrix is set with BENCH_ENGINES (default "0 1 2"), BENCH_TASKS (producers x consumers,
+# default "1x1 2x2 4x4 1x4 4x1"), BENCH_BUFFER_SIZES (default "4 10 64") and BENCH_BATCHES
+# (default "1 8"); BENCH_DEFS adds compile-time options to every build. LED requests are
+# compiled out (LED_SERVICE=0) so that the single ledSrvTask does not dominate the result,
+# the producers use a fixed RNG_SEED, and the SPSC engine (1) is only run at 1x1. statsRows
+# is sized for the largest BENCH_TASKS entry (STATS_TASKS), and a run which fails or leaves
+# Tasks out of its totals stops the benchmark rather than write a wrong row.
+# Compare two result files with bench_compare.sh.
+
+BACKEND=pc_sim
+RUN_MS=1000
+CSV=
+JSON=
+while getopts b:t:o:j: opt; do
+	case $opt in
+	b) BACKEND=$OPTARG ;;
+	t) RUN_MS=$OPTARG ;;
+	o) CSV=$OPTARG ;;
+	j) JSON=$OPTARG ;;
+	*) sed -n '6p' "$0" >&2; exit 2 ;;
+	esac
+done
+case $BACKEND in
+pc_sim|pc_host) ;;
+*) echo "bench.sh: unknown backend $BACKEND" >&2; exit 2 ;;
+esac
+
+ENGINES=${BENCH_ENGINES:-"0 1 2"}
+TASKS=${BENCH_TASKS:-"1x1 2x2 4x4 1x4 4x1"}
+BUFFER_SIZES=${BENCH_BUFFER_SIZES:-"4 10 64"}
+BATCHES=${BENCH_BATCHES:-"1 8"}
+HERE=$(cd "$(dirname "$0")" && pwd) || exit 1
+COMMIT=$(git -C "$HERE" describe --always --dirty 2>/dev/null || echo unknown)
+TMP=$(mktemp) || exit 1
+RUN=$(mktemp) || exit 1
+trap 'rm -f "$TMP" "$RUN"' EXIT
+STATS_TASKS=1
+for tasks in $TASKS; do
+	n=$((${tasks%x*} + ${tasks#*x} + 1))	#producers + consumers + ledSrvTask
+	if [ $n -gt $STATS_TASKS ]; then STATS_TASKS=$n; fi
+done
+
+echo "commit,backend,engine,producers,consumers,buffer_size,batch,run_ms,items_per_sec,lat_p50_us,lat_p99_us,lat_p999_us,lat_max_us" >"$TMP"
+for engine in $ENGINES; do
+	for size in $BUFFER_SIZES; do
+		for batch in $BATCHES; do
+			defs="-DBUFFER_ENGINE=$engine -DBUFFER_SIZE=$size -DPRODUCER_BATCH_SIZE=$batch"
+			defs="$defs -DCONSUMER_BATCH_SIZE=$batch -DLED_SERVICE=0 -DRNG_SEED=1 $BENCH_DEFS"
+			make -s -B -C "$HERE" STATS_TASKS=$STATS_TASKS DEFS="$defs" "$BACKEND" >&2 || exit 1
+			for tasks in $TASKS; do
+				producers=${tasks%x*}
+				consumers=${tasks#*x}
+				if [ "$engine" = 1 ] && [ "$tasks" != 1x1 ]; then continue; fi
+				echo "bench.sh: engine=$engine size=$size batch=$batch tasks=$tasks" >&2
+				if ! PC_PRODUCERS=$producers PC_CONSUMERS=$consumers PC_RUN_MS=$RUN_MS \
+					"$HERE/$BACKEND" >"$RUN" 2>&1 || grep -q "not counted" "$RUN"; then
+					echo "bench.sh: engine=$engine size=$size batch=$batch tasks=$tasks failed:" >&2
+					cat "$RUN" >&2
+					exit 1
+				fi
+				awk -v prefix="$COMMIT,$BACKEND,$engine,$producers,$consumers,$size,$batch,$RUN_MS" '
+						/^throughput:/ { rate = $2 }
+						/^item latency us:/ {
+							for(i = 4; i <= NF; i++) { split($i, kv, "="); lat[kv[1]] = kv[2] }
+						}
+						END {
+							printf "%s,%s,%s,%s,%s,%s\n", prefix, rate, lat["p50"], lat["p99"],
+								   lat["p999"], lat["max"]
+						}' "$RUN" >>"$TMP"
+			done
+		done
+	done
+done
+make -s -B -C "$HERE" >&2
+
+if [ -n "$CSV" ]; then cp "$TMP" "$CSV"; else cat "$TMP"; fi
+if [ -n "$JSON" ]; then
+	awk -F, '
+		NR == 1 { n = split($0, key, ","); next }
+		{
+			printf "%s\n    {", (NR == 2 ? "[" : ",")
+			for(i = 1; i <= n; i++)
+			{
+				quote = (i <= 2) ? "\"" : ""
+				value = ($i == "") ? "null" : quote $i quote
+				printf "%s\"%s\": %s", (i > 1 ? ", " : ""), key[i], value
+			}
+			printf "}"
+		}
+		END { print (NR > 1 ? "\n]" : "[]") }' "$TMP" >"$JSON"
+fi
@@ -0,0 +1,72 @@
+#!/bin/sh
+# Compares two bench.sh CSV result files, configuration by configuration (backend, engine,
+# producers, consumers, buffer size, batch), and flags the regressions: items/sec lower, or
+# p99 item latency higher, than in the base run by more than the threshold.
+#
+#   ./bench_compare.sh base.csv new.csv [threshold_percent]
+#
+# The threshold defaults to 5 (%). Exits with status 1 if any configuration regressed, so
+# it can gate a change. pc_sim results are deterministic and compare at any threshold;
+# pc_host results carry scheduling noise - rerun or use a larger threshold before blaming
+# the code.
+
+if [ $# -lt 2 ]; then
+	sed -n '6p' "$0" >&2
+	exit 2
+fi
+BASE=$1
+NEW=$2
+THRESHOLD=${3:-5}
+
+awk -F, -v threshold="$THRESHOLD" '
+	function col(name) { return idx[name] }
+	function pct(from, to) { return from > 0 ? (to - from) * 100.0 / from : 0 }
+	FNR == 1 {
+		file++
+		for(i = 1; i <= NF; i++)
+			idx[$i] = i
+		next
+	}
+	{
+		key = $col("backend") "," $col("engine") "," $col("producers") "x" $col("consumers") \
+			  "," $col("buffer_size") "," $col("batch")
+		rate = $col("items_per_sec")
+		p99 = $col("lat_p99_us")
+	}
+	file == 1 {
+		baseRate[key] = rate
+		baseP99[key] = p99
+		next
+	}
+	{
+		if(!(key in baseRate))
+		{
+			printf "%-28s %12s %12s %8s %10s %10s %8s  new\n", key, "-", rate, "", "-", p99, ""
+			next
+		}
+		seen[key] = 1
+		dRate = pct(baseRate[key], rate)
+		dP99 = pct(baseP99[key], p99)
+		flag = ""
+		if(dRate < -threshold || (p99 != "" && dP99 > threshold))
+		{
+			flag = "  REGRESSION"
+			regressions++
+		}
+		else if(dRate > threshold || (p99 != "" && dP99 < -threshold))
+			flag = "  improved"
+		printf "%-28s %12s %12s %+7.1f%% %10s %10s %+7.1f%%%s\n", key, baseRate[key], rate, dRate,
+			   baseP99[key], p99, dP99, flag
+	}
+	BEGIN {
+		printf "%-28s %12s %12s %8s %10s %10s %8s\n", "backend,engine,tasks,size,batch",
+			   "base items/s", "new items/s", "delta", "base p99us", "new p99us", "delta"
+	}
+	END {
+		for(key in baseRate)
+			if(!(key in seen))
+				printf "%-28s %12s %12s %8s %10s %10s %8s  missing\n", key, baseRate[key], "-", "",
+					   baseP99[key], "-", ""
+		printf "%d regression(s) beyond %s%%\n", regressions, threshold
+		exit regressions > 0
+	}' "$BASE" "$NEW"
@@ -0,0 +1,34 @@
+#!/bin/sh
+# Scaling benchmark of the buffer engines on the host build: runs N producers x N consumers
+# for N = 1, 2, 4, 8, 16 and prints items/sec per engine.
+#
+#   ./bench_scaling.sh [run_ms] [engines]
+#
+# LED requests are compiled out (LED_SERVICE=0) so that the single ledSrvTask does not
+# dominate the result. The SPSC engine (1) is only meaningful at 1x1 and is measured there.
+# statsRows is sized for the largest run (STATS_TASKS), and a run which still left Tasks out
+# of its totals stops the script rather than print a low items/sec.
+
+RUN_MS=${1:-1000}
+ENGINES=${2:-"0 2"}
+MAX_N=16
+cd "$(dirname "$0")" || exit 1
+TMP=$(mktemp) || exit 1
+trap 'rm -f "$TMP"' EXIT
+
+printf '%-8s %8s %14s\n' engine tasks items/sec
+for engine in $ENGINES; do
+	make -s -B STATS_TASKS=$((2 * MAX_N + 1)) DEFS="-DBUFFER_ENGINE=$engine -DLED_SERVICE=0" || exit 1
+	if [ "$engine" = 1 ]; then sizes=1; else sizes="1 2 4 8 $MAX_N"; fi
+	for n in $sizes; do
+		if ! PC_PRODUCERS=$n PC_CONSUMERS=$n PC_RUN_MS=$RUN_MS ./pc_host >"$TMP" 2>&1 ||
+			grep -q "not counted" "$TMP"; then
+			echo "bench_scaling.sh: engine=$engine ${n}x${n} failed:" >&2
+			cat "$TMP" >&2
+			exit 1
+		fi
+		rate=$(awk '/^throughput:/ { print $2 }' "$TMP")
+		printf '%-8s %8s %14s\n' "$engine" "${n}x${n}" "$rate"
+	done
+done
+make -s -B
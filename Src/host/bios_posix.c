@@ -0,0 +1,497 @@
+/*
+ bios_posix.c
+
+ POSIX-threads backend for the host build of main.c (see include/bios_host.h).
+
+ Every Task runs on its own pthread and the Linux scheduler provides preemption, so Task
+ priorities from empty.cfg are recorded but not enforced - the host build is meant for
+ measuring the producer/consumer data path at full speed, not for reproducing the exact
+ BIOS interleaving. Semaphores are built from one kernel-wide lock (much like BIOS disabling
+ interrupts) and a condition variable per semaphore. Clocks run on a helper thread each and
+ call their function every "period" Clock ticks of Clock_tickPeriod microseconds.
+
+ So main.c's time slicing does not work here: tsClockHandler runs on the Clock's thread,
+ where Task_self() is NULL, and Task_stat/Task_getMode report every Task as ready. With
+ TIME_SLICE_ADAPTIVE it finds no running Task on any tick and leaves the threads alone (with
+ TICKLESS it stops timeSharingClk, and the next post starts it again), so its ticks/yields/
+ kept figures stay 0. Use pc_sim, which models the BIOS scheduler, to measure time slicing
+ and tickless idle.
+
+ The run is controlled through environment variables:
+
+ 	PC_PRODUCERS - number of producer tasks to start (default: as in empty.cfg)
+ 	PC_CONSUMERS - number of consumer tasks to start (default: as in empty.cfg)
+ 	PC_RUN_MS    - how long to let the system run before reporting (default: 2000)
+ 	PC_LOG       - set to 1 to print every Log_info call (default: off)
+	PC_TRACE     - set to 1 to print the trace ring at the end (TRACE_SINK_RING; empty_cfg.c)
+	PC_TRACE_FILE- save the trace ring there at the end, for trace_decode (empty_cfg.c)
+
+ BIOS_start never returns: after PC_RUN_MS it prints the report and terminates the process.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bios_host.h"
+
+typedef struct
+{
+	pthread_cond_t cond;
+} SemaphoreBackend;
+
+typedef struct
+{
+	pthread_t thread;
+	pthread_cond_t cond;
+	Bool running;
+	UInt32 generation;
+	struct timespec next;
+} ClockBackend;
+
+static pthread_mutex_t kernelLock = PTHREAD_MUTEX_INITIALIZER;
+static __thread Task_Handle currentTask;
+static struct timespec startTime;
+static Bool logEnabled;
+
+//-----------------------------------------
+// Helpers
+//-----------------------------------------
+static UInt64 nowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (UInt64)ts.tv_sec * 1000000000ull + (UInt64)ts.tv_nsec;
+}
+
+static void addTicks(struct timespec *ts, UInt32 ticks)
+{
+	UInt64 ns = (UInt64)ticks * Clock_tickPeriod * 1000ull + (UInt64)ts->tv_nsec;
+	ts->tv_sec += (time_t)(ns / 1000000000ull);
+	ts->tv_nsec = (long)(ns % 1000000000ull);
+}
+
+static Int envInt(const char *name, Int defaultValue)
+{
+	const char *value = getenv(name);
+	return (value != NULL && *value != '\0') ? atoi(value) : defaultValue;
+}
+
+static void *xcalloc(size_t size)
+{
+	void *p = calloc(1, size);
+	if(p == NULL)
+	{
+		perror("calloc");
+		exit(EXIT_FAILURE);
+	}
+	return p;
+}
+
+/*
+ Runs before main(): main() already calls Semaphore_reset, so the objects must be usable
+ before BIOS_start, exactly as statically created objects are on the target.
+ */
+__attribute__((constructor))
+static void hostInit(void)
+{
+	Int i;
+	pthread_condattr_t attr;
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	for(i = 0; i < hostSemaphoreCount; i++)
+	{
+		SemaphoreBackend *sb = xcalloc(sizeof(*sb));
+		pthread_cond_init(&sb->cond, &attr);
+		hostSemaphores[i]->backend = sb;
+	}
+	for(i = 0; i < hostClockCount; i++)
+	{
+		ClockBackend *cb = xcalloc(sizeof(*cb));
+		pthread_cond_init(&cb->cond, NULL);
+		hostClocks[i]->backend = cb;
+	}
+	pthread_condattr_destroy(&attr);
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	logEnabled = envInt("PC_LOG", 0);
+}
+
+//-----------------------------------------
+// Task
+//-----------------------------------------
+Task_Handle Task_self(void)
+{
+	return currentTask;
+}
+
+void Task_yield(void)
+{
+	sched_yield();
+}
+
+void Task_sleep(UInt32 nticks)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	addTicks(&ts, nticks);
+	while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+		;
+}
+
+void Task_setEnv(Task_Handle handle, Ptr env)
+{
+	handle->env = env;
+}
+
+Ptr Task_getEnv(Task_Handle handle)
+{
+	return handle->env;
+}
+
+String Task_Handle_name(Task_Handle handle)
+{
+	return (String)handle->name;
+}
+
+Int Task_getPri(Task_Handle handle)
+{
+	return handle->priority;
+}
+
+//Only recorded: the threads all run at the host's default scheduling priority
+Int Task_setPri(Task_Handle handle, Int newpri)
+{
+	Int old = handle->priority;
+	handle->priority = newpri;
+	return old;
+}
+
+//The threads run on stacks the C library sizes and does not paint: no high-water mark here
+void Task_stat(Task_Handle handle, Task_Stat *statbuf)
+{
+	memset(statbuf, 0, sizeof(*statbuf));
+	statbuf->priority = handle->priority;
+	statbuf->env = handle->env;
+	statbuf->mode = Task_Mode_READY;
+}
+
+//The Linux scheduler keeps the thread states: every Task counts as ready (see the top)
+Task_Mode Task_getMode(Task_Handle handle)
+{
+	return Task_Mode_READY;
+}
+
+Task_Handle Task_getIdleTask(void)
+{
+	return NULL;
+}
+
+static void *taskThread(void *arg)
+{
+	currentTask = (Task_Handle)arg;
+	currentTask->fxn(currentTask->arg0, currentTask->arg1);
+	return NULL;
+}
+
+static void taskStart(Task_Handle task)
+{
+	pthread_t thread;
+	if(pthread_create(&thread, NULL, taskThread, task) != 0)
+	{
+		perror("pthread_create");
+		exit(EXIT_FAILURE);
+	}
+	pthread_detach(thread);
+}
+
+//-----------------------------------------
+// Semaphore
+//-----------------------------------------
+Bool Semaphore_pend(Semaphore_Handle handle, UInt32 timeout)
+{
+	SemaphoreBackend *sb = handle->backend;
+	struct timespec deadline;
+	UInt64 start, waited;
+
+	pthread_mutex_lock(&kernelLock);
+	handle->pends++;
+	if(handle->count > 0)
+	{
+		handle->count--;
+		pthread_mutex_unlock(&kernelLock);
+		return TRUE;
+	}
+	if(timeout == BIOS_NO_WAIT)
+	{
+		pthread_mutex_unlock(&kernelLock);
+		return FALSE;
+	}
+
+	handle->blockedPends++;
+	start = nowNs();
+	if(timeout != BIOS_WAIT_FOREVER)
+	{
+		clock_gettime(CLOCK_MONOTONIC, &deadline);
+		addTicks(&deadline, timeout);
+	}
+	while(handle->count == 0)
+	{
+		if(timeout == BIOS_WAIT_FOREVER)
+			pthread_cond_wait(&sb->cond, &kernelLock);
+		else if(pthread_cond_timedwait(&sb->cond, &kernelLock, &deadline) == ETIMEDOUT)
+			break;
+	}
+	waited = nowNs() - start;
+	handle->waitTotalNs += waited;
+	if(waited > handle->waitMaxNs)
+		handle->waitMaxNs = waited;
+	if(handle->count == 0)
+	{
+		pthread_mutex_unlock(&kernelLock);
+		return FALSE;
+	}
+	handle->count--;
+	pthread_mutex_unlock(&kernelLock);
+	return TRUE;
+}
+
+void Semaphore_post(Semaphore_Handle handle)
+{
+	SemaphoreBackend *sb = handle->backend;
+
+	pthread_mutex_lock(&kernelLock);
+	if(handle->mode == Semaphore_Mode_BINARY)
+		handle->count = 1;
+	else
+		handle->count++;
+	pthread_cond_signal(&sb->cond);
+	pthread_mutex_unlock(&kernelLock);
+}
+
+Int Semaphore_getCount(Semaphore_Handle handle)
+{
+	return handle->count;
+}
+
+void Semaphore_reset(Semaphore_Handle handle, Int count)
+{
+	pthread_mutex_lock(&kernelLock);
+	handle->count = count;
+	pthread_mutex_unlock(&kernelLock);
+}
+
+//-----------------------------------------
+// Clock
+//-----------------------------------------
+UInt32 Clock_getTicks(void)
+{
+	UInt64 startNs = (UInt64)startTime.tv_sec * 1000000000ull + (UInt64)startTime.tv_nsec;
+	return (UInt32)((nowNs() - startNs) / (Clock_tickPeriod * 1000ull));
+}
+
+void Clock_start(Clock_Handle handle)
+{
+	ClockBackend *cb = handle->backend;
+
+	pthread_mutex_lock(&kernelLock);
+	clock_gettime(CLOCK_MONOTONIC, &cb->next);
+	addTicks(&cb->next, handle->timeout);
+	cb->running = TRUE;
+	cb->generation++;
+	pthread_cond_signal(&cb->cond);
+	pthread_mutex_unlock(&kernelLock);
+}
+
+void Clock_stop(Clock_Handle handle)
+{
+	ClockBackend *cb = handle->backend;
+
+	pthread_mutex_lock(&kernelLock);
+	cb->running = FALSE;
+	cb->generation++;
+	pthread_mutex_unlock(&kernelLock);
+}
+
+void Clock_setTimeout(Clock_Handle handle, UInt32 timeout)
+{
+	pthread_mutex_lock(&kernelLock);
+	handle->timeout = timeout;
+	pthread_mutex_unlock(&kernelLock);
+}
+
+static void *clockThread(void *arg)
+{
+	Clock_Handle handle = (Clock_Handle)arg;
+	ClockBackend *cb = handle->backend;
+	struct timespec next;
+	UInt32 generation;
+
+	for(;;)
+	{
+		pthread_mutex_lock(&kernelLock);
+		while(!cb->running)
+			pthread_cond_wait(&cb->cond, &kernelLock);
+		next = cb->next;
+		generation = cb->generation;
+		pthread_mutex_unlock(&kernelLock);
+
+		while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR)
+			;
+
+		pthread_mutex_lock(&kernelLock);
+		if(!cb->running || cb->generation != generation)
+		{
+			pthread_mutex_unlock(&kernelLock);
+			continue;
+		}
+		if(handle->period == 0)
+			cb->running = FALSE;
+		else
+			addTicks(&cb->next, handle->period);
+		pthread_mutex_unlock(&kernelLock);
+
+		handle->fxn(handle->arg);
+	}
+	return NULL;
+}
+
+//-----------------------------------------
+// Timestamp
+//-----------------------------------------
+UInt32 Timestamp_get32(void)
+{
+	return (UInt32)nowNs();
+}
+
+void Timestamp_getFreq(Types_FreqHz *freq)
+{
+	freq->hi = 0;
+	freq->lo = 1000000000u;
+}
+
+//-----------------------------------------
+// Log
+//-----------------------------------------
+void Log_host_print(const char *fmt, UArg a1, UArg a2)
+{
+	if(!logEnabled)
+		return;
+	flockfile(stdout);
+	Log_host_format(fmt, a1, a2);
+	funlockfile(stdout);
+}
+
+//-----------------------------------------
+// BIOS
+//-----------------------------------------
+
+/*
+ Starts "wanted" tasks of the given role: the statically configured ones first (in arg0
+ order, as their IDs were given in empty.cfg) and then clones of the first one, numbered on.
+ */
+static Int startRole(HostRole role, Int wanted)
+{
+	Task_Handle first = NULL;
+	Task_Object model;
+	Int started = 0;
+	Int i;
+
+	for(i = 0; i < hostTaskCount; i++)
+		if(hostTasks[i]->role == role && (first == NULL || hostTasks[i]->arg0 < first->arg0))
+			first = hostTasks[i];
+	if(first == NULL)
+		return 0;
+	//clones are copied from "first" as created, not as running: its Env holds its task ID
+	//(statsRows row) once it has started, and its backend its thread/coroutine state
+	model = *first;
+	model.env = NULL;
+	model.backend = NULL;
+	for(i = 0; i < hostTaskCount; i++)
+	{
+		Task_Handle task = hostTasks[i];
+		if(task->role == role && (Int)task->arg0 <= wanted)
+		{
+			taskStart(task);
+			started++;
+		}
+	}
+	while(started < wanted)
+	{
+		Task_Handle clone = xcalloc(sizeof(*clone));
+		*clone = model;
+		clone->arg0 = (UArg)++started;
+		clone->name = "clone";
+		taskStart(clone);
+	}
+	return started;
+}
+
+static Int staticRoleCount(HostRole role)
+{
+	Int n = 0;
+	Int i;
+	for(i = 0; i < hostTaskCount; i++)
+		n += hostTasks[i]->role == role;
+	return n;
+}
+
+static void report(double elapsedSec, Int producers, Int consumers)
+{
+	Int i;
+
+	printf("host run: %.3f s, producers=%d consumers=%d\n", elapsedSec, producers, consumers);
+	hostAppReport(elapsedSec);
+	printf("%-16s %12s %12s %14s %14s\n", "semaphore", "pends", "blocked", "avg wait us", "max wait us");
+	for(i = 0; i < hostSemaphoreCount; i++)
+	{
+		Semaphore_Handle sem = hostSemaphores[i];
+		double avgUs = sem->blockedPends ? sem->waitTotalNs / 1000.0 / sem->blockedPends : 0.0;
+		printf("%-16s %12lu %12lu %14.2f %14.2f\n", sem->name, (unsigned long)sem->pends,
+			   (unsigned long)sem->blockedPends, avgUs, sem->waitMaxNs / 1000.0);
+	}
+}
+
+void BIOS_start(void)
+{
+	Int producers = envInt("PC_PRODUCERS", staticRoleCount(HostRole_PRODUCER));
+	Int consumers = envInt("PC_CONSUMERS", staticRoleCount(HostRole_CONSUMER));
+	Int runMs = envInt("PC_RUN_MS", 2000);
+	struct timespec end;
+	UInt64 begin;
+	Int i;
+
+	begin = nowNs();
+	for(i = 0; i < hostClockCount; i++)
+	{
+		ClockBackend *cb = hostClocks[i]->backend;
+		pthread_create(&cb->thread, NULL, clockThread, hostClocks[i]);
+		pthread_detach(cb->thread);
+		if(hostClocks[i]->startFlag)
+			Clock_start(hostClocks[i]);
+	}
+	startRole(HostRole_SERVICE, staticRoleCount(HostRole_SERVICE));
+	producers = startRole(HostRole_PRODUCER, producers);
+	consumers = startRole(HostRole_CONSUMER, consumers);
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	end.tv_sec += runMs / 1000;
+	end.tv_nsec += (runMs % 1000) * 1000000L;
+	if(end.tv_nsec >= 1000000000L)
+	{
+		end.tv_sec++;
+		end.tv_nsec -= 1000000000L;
+	}
+	while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &end, NULL) == EINTR)
+		;
+
+	pthread_mutex_lock(&kernelLock);
+	report((nowNs() - begin) / 1e9, producers, consumers);
+	fflush(stdout);
+	_exit(EXIT_SUCCESS);
+}
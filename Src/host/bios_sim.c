@@ -0,0 +1,854 @@
+/*
+ bios_sim.c
+
+ Discrete-event simulator backend for the host build of main.c (see include/bios_host.h).
+
+ Unlike bios_posix.c, which runs every Task on its own pthread at full speed, this backend
+ reproduces the BIOS scheduling rules in virtual time, on a single thread:
+
+ 	- every Task is a coroutine (ucontext) with its own stack; exactly one of them runs;
+ 	- the highest priority ready Task runs; equal priorities run in FIFO order, a preempted
+ 	  Task keeps its place at the head of its ready queue and Task_yield moves it to the tail;
+ 	- Semaphores wake the pending Task of the highest priority first (FIFO among equals), and
+ 	  a post that readies a higher priority Task switches to it immediately;
+ 	- Clock objects expire on Clock ticks of Clock_tickPeriod microseconds and their functions
+ 	  run "in Swi context": Task_yield there yields the Task that was interrupted.
+
+ Virtual time only moves on kernel calls: each Semaphore/Task/Clock/Log call is charged
+ PC_SIM_CALL_CYCLES MCLK cycles (standing for the call itself and the application code that
+ led to it) and each Task switch PC_SIM_SWITCH_CYCLES. Clock ticks that fall inside a charged
+ interval are processed at the end of it, so preemption is as fine grained as the cost model.
+ When no Task is ready, time jumps to the next Clock tick.
+
+ The run is controlled through environment variables:
+
+ 	PC_PRODUCERS        - number of producer tasks to start (default: as in empty.cfg)
+ 	PC_CONSUMERS        - number of consumer tasks to start (default: as in empty.cfg)
+ 	PC_RUN_MS           - virtual run length in milliseconds (default: 2000)
+ 	PC_LOG              - set to 1 to print every Log_info call, stamped with virtual time
+	PC_TRACE            - set to 1 to print the trace ring at the end (TRACE_SINK_RING; empty_cfg.c)
+	PC_TRACE_FILE       - save the trace ring there at the end, for trace_decode (empty_cfg.c)
+ 	PC_SIM_MCLK_KHZ     - simulated MCLK frequency (default: 8000, as set by hardware_init)
+ 	PC_SIM_CALL_CYCLES  - cycles charged per kernel call (default: 200)
+ 	PC_SIM_SWITCH_CYCLES- cycles charged per Task switch (default: 150)
+ 	PC_SIM_TICKLESS     - 1: Clock.tickMode = TickMode_DYNAMIC - an idle CPU sleeps until the
+ 	                      next Clock object or Task_sleep is due instead of waking every tick
+ 	PC_SIM_IDLE_MODE    - what the idle Task does: "active" (spins - the default, as in
+ 	                      empty.cfg), "lpm0" or "lpm3" (Power.idle with that Power.idleMode)
+ 	PC_SIM_ACTIVE_UA    - supply current while the CPU runs, uA (default: 2300 - MSP430F5529
+ 	                      active mode at 8 MHz)
+ 	PC_SIM_LPM0_UA      - supply current in LPM0, uA (default: 80)
+ 	PC_SIM_LPM3_UA      - supply current in LPM3, uA (default: 2)
+ 	PC_SIM_VCC_MV       - supply voltage, mV (default: 3000)
+ 	PC_SIM_WAKE_CYCLES  - active cycles per wakeup of an idle CPU: the timer interrupt, the
+ 	                      Clock tick and the way back to sleep (default: 150)
+
+  The power report splits the run into active time (Tasks, Clock functions, Task switches and
+ the wakeups of an idle CPU) and idle time, and prices them with the current table above: duty
+ cycle, wakeups per second, average current and energy per consumed item (hostAppItems).
+
+ Timestamp_get32 returns virtual time too (it also seeds the producers' random generators),
+ so the same configuration always produces the same run. BIOS_start never returns: at the end
+ of the virtual run (or if every Task is blocked with no Clock left to wake one) it prints
+ the report and terminates the process.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include "bios_host.h"
+
+#define SIM_STACK_SIZE (256 * 1024)
+#define SIM_STACK_FILL 0xA5					//Task_stat finds the high-water mark by this pattern
+#define SIM_PRIORITIES 16
+
+typedef enum
+{
+	SimTask_READY,
+	SimTask_RUNNING,
+	SimTask_BLOCKED,
+	SimTask_TERMINATED
+} SimTaskState;
+
+typedef struct SimTask
+{
+	Task_Handle handle;
+	ucontext_t context;
+	void *stack;
+	SimTaskState state;
+	struct SimTask *next;			//ready queue or semaphore wait list
+	Semaphore_Handle pendOn;
+	UInt64 wakeTick;				//0 - no timeout
+	Bool timedOut;
+	UInt64 cpuNs;
+	UInt32 dispatches;
+	struct SimTask *nextTask;		//list of all tasks, for the report
+} SimTask;
+
+typedef struct
+{
+	SimTask *head;
+	SimTask *tail;
+} SimQueue;
+
+typedef struct
+{
+	SimQueue waiters;
+} SemaphoreBackend;
+
+typedef struct
+{
+	Bool running;
+	UInt64 dueTick;
+} ClockBackend;
+
+static ucontext_t schedContext;
+static SimTask *currentTask;
+static SimTask *allTasks;
+static SimQueue readyQueues[SIM_PRIORITIES];
+
+static UInt64 simNow;				//virtual time, ns
+static UInt64 simTick;				//Clock ticks processed
+static UInt64 tickNs;
+static UInt64 callNs;
+static UInt64 switchNs;
+static UInt64 endNs;
+static UInt64 idleNs;
+static UInt32 contextSwitches;
+static UInt64 wakeNs;
+static UInt32 idleWakeups;			//timer interrupts that woke an idle CPU
+static Bool tickless;
+static Bool inSwi;
+static Bool yieldPending;
+static Bool logEnabled;
+
+static UInt64 occupancySum;
+static Int occupancyMax;
+
+static Int runProducers;
+static Int runConsumers;
+
+//-----------------------------------------
+// Helpers
+//-----------------------------------------
+static UInt64 hostNowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (UInt64)ts.tv_sec * 1000000000ull + (UInt64)ts.tv_nsec;
+}
+
+static Int envInt(const char *name, Int defaultValue)
+{
+	const char *value = getenv(name);
+	return (value != NULL && *value != '\0') ? atoi(value) : defaultValue;
+}
+
+static void *xcalloc(size_t size)
+{
+	void *p = calloc(1, size);
+	if(p == NULL)
+	{
+		perror("calloc");
+		exit(EXIT_FAILURE);
+	}
+	return p;
+}
+
+static void queuePushBack(SimQueue *q, SimTask *t)
+{
+	t->next = NULL;
+	if(q->tail != NULL)
+		q->tail->next = t;
+	else
+		q->head = t;
+	q->tail = t;
+}
+
+static void queuePushFront(SimQueue *q, SimTask *t)
+{
+	t->next = q->head;
+	q->head = t;
+	if(q->tail == NULL)
+		q->tail = t;
+}
+
+static SimTask *queuePop(SimQueue *q)
+{
+	SimTask *t = q->head;
+	if(t != NULL)
+	{
+		q->head = t->next;
+		if(q->head == NULL)
+			q->tail = NULL;
+		t->next = NULL;
+	}
+	return t;
+}
+
+static void queueRemove(SimQueue *q, SimTask *t)
+{
+	SimTask *prev = NULL;
+	SimTask *p;
+
+	for(p = q->head; p != NULL; prev = p, p = p->next)
+	{
+		if(p != t)
+			continue;
+		if(prev != NULL)
+			prev->next = p->next;
+		else
+			q->head = p->next;
+		if(q->tail == p)
+			q->tail = prev;
+		p->next = NULL;
+		return;
+	}
+}
+
+static Int taskPriority(SimTask *t)
+{
+	Int priority = t->handle->priority;
+	if(priority < 0)
+		return 0;
+	return priority < SIM_PRIORITIES ? priority : SIM_PRIORITIES - 1;
+}
+
+/*
+ Semaphore.supportsPriority: a pending task goes behind the ones of its own or a higher
+ priority, so a post wakes the highest priority task, FIFO among equals
+ */
+static void queueInsertByPriority(SimQueue *q, SimTask *t)
+{
+	SimTask *prev = NULL;
+	SimTask *p;
+
+	for(p = q->head; p != NULL && taskPriority(p) >= taskPriority(t); p = p->next)
+		prev = p;
+	if(prev == NULL)
+	{
+		queuePushFront(q, t);
+		return;
+	}
+	t->next = p;
+	prev->next = t;
+	if(p == NULL)
+		q->tail = t;
+}
+
+static Int highestReadyPriority(void)
+{
+	Int priority;
+	for(priority = SIM_PRIORITIES - 1; priority >= 0; priority--)
+		if(readyQueues[priority].head != NULL)
+			return priority;
+	return -1;
+}
+
+static void makeReady(SimTask *t, Bool atFront)
+{
+	t->state = SimTask_READY;
+	if(atFront)
+		queuePushFront(&readyQueues[taskPriority(t)], t);
+	else
+		queuePushBack(&readyQueues[taskPriority(t)], t);
+}
+
+static void report(const char *reason);
+
+//-----------------------------------------
+// Virtual time
+//-----------------------------------------
+
+/*
+ One Clock tick: expire the Clock objects in creation order, time out pends and sample the
+ buffer occupancy. Runs "in Swi context" on whatever stack is current.
+ */
+static void processTick(void)
+{
+	Int occupancy;
+	SimTask *t;
+	Int i;
+
+	simTick++;
+	inSwi = TRUE;
+	for(i = 0; i < hostClockCount; i++)
+	{
+		Clock_Handle clock = hostClocks[i];
+		ClockBackend *cb = clock->backend;
+		if(!cb->running || cb->dueTick != simTick)
+			continue;
+		if(clock->period == 0)
+			cb->running = FALSE;
+		else
+			cb->dueTick += clock->period;
+		clock->fxn(clock->arg);
+	}
+	for(t = allTasks; t != NULL; t = t->nextTask)
+	{
+		if(t->state != SimTask_BLOCKED || t->wakeTick == 0 || t->wakeTick > simTick)
+			continue;
+		if(t->pendOn != NULL)
+			queueRemove(&((SemaphoreBackend *)t->pendOn->backend)->waiters, t);
+		t->pendOn = NULL;
+		t->wakeTick = 0;
+		t->timedOut = TRUE;
+		makeReady(t, FALSE);
+	}
+	inSwi = FALSE;
+
+	occupancy = hostAppOccupancy();
+	occupancySum += (UInt64)occupancy;
+	if(occupancy > occupancyMax)
+		occupancyMax = occupancy;
+}
+
+static void advance(UInt64 ns)
+{
+	simNow += ns;
+	while((simTick + 1) * tickNs <= simNow)
+		processTick();
+	if(simNow >= endNs)
+		report("end of run");
+}
+
+//Gives the CPU back to the scheduler; the caller has already queued (or blocked) the task
+static void switchOut(void)
+{
+	SimTask *self = currentTask;
+	swapcontext(&self->context, &schedContext);
+}
+
+/*
+ Charges a kernel call to the running task and lets Clock ticks that elapsed meanwhile
+ take effect: a readied higher priority task preempts, a Task_yield from a Clock function
+ moves the running task behind its equal-priority peers.
+ */
+static void kernelCall(void)
+{
+	SimTask *self = currentTask;
+	Int priority;
+
+	if(inSwi || self == NULL)
+		return;
+	self->cpuNs += callNs;
+	advance(callNs);
+
+	priority = highestReadyPriority();
+	if(priority > taskPriority(self))
+	{
+		yieldPending = FALSE;
+		makeReady(self, TRUE);
+		switchOut();
+	}
+	else if(yieldPending)
+	{
+		yieldPending = FALSE;
+		if(priority == taskPriority(self))
+		{
+			makeReady(self, FALSE);
+			switchOut();
+		}
+	}
+}
+
+/*
+ Runs before main(): main() already calls Semaphore_reset, so the objects must be usable
+ before BIOS_start, exactly as statically created objects are on the target.
+ */
+__attribute__((constructor))
+static void hostInit(void)
+{
+	Int i;
+
+	for(i = 0; i < hostSemaphoreCount; i++)
+		hostSemaphores[i]->backend = xcalloc(sizeof(SemaphoreBackend));
+	for(i = 0; i < hostClockCount; i++)
+		hostClocks[i]->backend = xcalloc(sizeof(ClockBackend));
+	logEnabled = envInt("PC_LOG", 0);
+}
+
+//-----------------------------------------
+// Task
+//-----------------------------------------
+Task_Handle Task_self(void)
+{
+	return currentTask != NULL ? currentTask->handle : NULL;
+}
+
+void Task_yield(void)
+{
+	SimTask *self = currentTask;
+
+	if(inSwi || self == NULL)
+	{
+		yieldPending = TRUE;
+		return;
+	}
+	kernelCall();
+	if(highestReadyPriority() >= taskPriority(self))
+	{
+		makeReady(self, FALSE);
+		switchOut();
+	}
+}
+
+void Task_sleep(UInt32 nticks)
+{
+	SimTask *self = currentTask;
+
+	kernelCall();
+	if(nticks == 0)
+		return;
+	self->state = SimTask_BLOCKED;
+	self->pendOn = NULL;
+	self->wakeTick = simTick + nticks;
+	switchOut();
+}
+
+void Task_setEnv(Task_Handle handle, Ptr env)
+{
+	handle->env = env;
+}
+
+Ptr Task_getEnv(Task_Handle handle)
+{
+	return handle->env;
+}
+
+String Task_Handle_name(Task_Handle handle)
+{
+	return (String)handle->name;
+}
+
+Int Task_getPri(Task_Handle handle)
+{
+	return handle->priority;
+}
+
+//A ready task moves to the tail of its new priority's queue; a running one is preempted at
+//once if it is no longer of the highest ready priority
+Int Task_setPri(Task_Handle handle, Int newpri)
+{
+	SimTask *t = handle->backend;
+	Int old = handle->priority;
+
+	if(t->state == SimTask_READY)
+	{
+		queueRemove(&readyQueues[taskPriority(t)], t);
+		handle->priority = newpri;
+		makeReady(t, FALSE);
+	}
+	else
+		handle->priority = newpri;
+	kernelCall();
+	return old;
+}
+
+Task_Mode Task_getMode(Task_Handle handle)
+{
+	SimTask *t = handle->backend;
+
+	return t->state == SimTask_READY ? Task_Mode_READY :
+		   t->state == SimTask_RUNNING ? Task_Mode_RUNNING :
+		   t->state == SimTask_BLOCKED ? Task_Mode_BLOCKED : Task_Mode_TERMINATED;
+}
+
+//Like BIOS, the stacks are filled with SIM_STACK_FILL at start-up, so the high-water mark is
+//the first byte, from the (low) end the stack grows towards, that no longer holds it
+void Task_stat(Task_Handle handle, Task_Stat *statbuf)
+{
+	SimTask *t = handle->backend;
+	const unsigned char *p = t->stack;
+	size_t untouched = 0;
+
+	memset(statbuf, 0, sizeof(*statbuf));
+	statbuf->priority = handle->priority;
+	statbuf->stack = t->stack;
+	statbuf->stackSize = SIM_STACK_SIZE;
+	statbuf->env = handle->env;
+	statbuf->mode = Task_getMode(handle);
+	while(untouched < SIM_STACK_SIZE && p[untouched] == SIM_STACK_FILL)
+		untouched++;
+	statbuf->used = SIM_STACK_SIZE - untouched;
+}
+
+Task_Handle Task_getIdleTask(void)
+{
+	return NULL;
+}
+
+static void taskEntry(void)
+{
+	SimTask *self = currentTask;
+	self->handle->fxn(self->handle->arg0, self->handle->arg1);
+	self->state = SimTask_TERMINATED;
+	swapcontext(&self->context, &schedContext);
+}
+
+static void taskStart(Task_Handle handle)
+{
+	SimTask *t = xcalloc(sizeof(*t));
+
+	t->handle = handle;
+	t->stack = xcalloc(SIM_STACK_SIZE);
+	memset(t->stack, SIM_STACK_FILL, SIM_STACK_SIZE);
+	getcontext(&t->context);
+	t->context.uc_stack.ss_sp = t->stack;
+	t->context.uc_stack.ss_size = SIM_STACK_SIZE;
+	t->context.uc_link = NULL;
+	makecontext(&t->context, taskEntry, 0);
+	handle->backend = t;
+	t->nextTask = allTasks;
+	allTasks = t;
+	makeReady(t, FALSE);
+}
+
+//-----------------------------------------
+// Semaphore
+//-----------------------------------------
+Bool Semaphore_pend(Semaphore_Handle handle, UInt32 timeout)
+{
+	SemaphoreBackend *sb = handle->backend;
+	SimTask *self = currentTask;
+	UInt64 start, waited;
+
+	kernelCall();
+	handle->pends++;
+	if(handle->count > 0)
+	{
+		handle->count--;
+		return TRUE;
+	}
+	if(timeout == BIOS_NO_WAIT || self == NULL)
+		return FALSE;
+
+	handle->blockedPends++;
+	start = simNow;
+	self->state = SimTask_BLOCKED;
+	self->pendOn = handle;
+	self->timedOut = FALSE;
+	self->wakeTick = (timeout == BIOS_WAIT_FOREVER) ? 0 : simTick + timeout;
+	queueInsertByPriority(&sb->waiters, self);
+	switchOut();
+
+	waited = simNow - start;
+	handle->waitTotalNs += waited;
+	if(waited > handle->waitMaxNs)
+		handle->waitMaxNs = waited;
+	return !self->timedOut;
+}
+
+void Semaphore_post(Semaphore_Handle handle)
+{
+	SemaphoreBackend *sb = handle->backend;
+	SimTask *self = currentTask;
+	SimTask *waiter;
+
+	kernelCall();
+	waiter = queuePop(&sb->waiters);
+	if(waiter == NULL)
+	{
+		if(handle->mode == Semaphore_Mode_BINARY)
+			handle->count = 1;
+		else
+			handle->count++;
+		return;
+	}
+	//the token goes straight to the first pending task
+	waiter->pendOn = NULL;
+	waiter->wakeTick = 0;
+	makeReady(waiter, FALSE);
+	if(!inSwi && self != NULL && taskPriority(waiter) > taskPriority(self))
+	{
+		makeReady(self, TRUE);
+		switchOut();
+	}
+}
+
+Int Semaphore_getCount(Semaphore_Handle handle)
+{
+	return handle->count;
+}
+
+void Semaphore_reset(Semaphore_Handle handle, Int count)
+{
+	handle->count = count;
+}
+
+//-----------------------------------------
+// Clock
+//-----------------------------------------
+UInt32 Clock_getTicks(void)
+{
+	return (UInt32)simTick;
+}
+
+void Clock_start(Clock_Handle handle)
+{
+	ClockBackend *cb = handle->backend;
+
+	kernelCall();
+	cb->running = TRUE;
+	cb->dueTick = simTick + (handle->timeout > 0 ? handle->timeout : 1);
+}
+
+void Clock_stop(Clock_Handle handle)
+{
+	ClockBackend *cb = handle->backend;
+
+	kernelCall();
+	cb->running = FALSE;
+}
+
+void Clock_setTimeout(Clock_Handle handle, UInt32 timeout)
+{
+	handle->timeout = timeout;
+}
+
+//-----------------------------------------
+// Timestamp
+//-----------------------------------------
+UInt32 Timestamp_get32(void)
+{
+	return (UInt32)simNow;
+}
+
+void Timestamp_getFreq(Types_FreqHz *freq)
+{
+	freq->hi = 0;
+	freq->lo = 1000000000u;
+}
+
+//-----------------------------------------
+// Log
+//-----------------------------------------
+void Log_host_print(const char *fmt, UArg a1, UArg a2)
+{
+	kernelCall();
+	if(!logEnabled)
+		return;
+	printf("[%12.6f] ", simNow / 1e9);
+	Log_host_format(fmt, a1, a2);
+}
+
+//-----------------------------------------
+// BIOS
+//-----------------------------------------
+
+/*
+ Starts "wanted" tasks of the given role: the statically configured ones first (in arg0
+ order, as their IDs were given in empty.cfg) and then clones of the first one, numbered on.
+ */
+static Int startRole(HostRole role, Int wanted)
+{
+	Task_Handle first = NULL;
+	Task_Object model;
+	Int started = 0;
+	Int i;
+
+	for(i = 0; i < hostTaskCount; i++)
+		if(hostTasks[i]->role == role && (first == NULL || hostTasks[i]->arg0 < first->arg0))
+			first = hostTasks[i];
+	if(first == NULL)
+		return 0;
+	//clones are copied from "first" as created, not as running: its Env holds its task ID
+	//(statsRows row) once it has started, and its backend its thread/coroutine state
+	model = *first;
+	model.env = NULL;
+	model.backend = NULL;
+	for(i = 0; i < hostTaskCount; i++)
+	{
+		Task_Handle task = hostTasks[i];
+		if(task->role == role && (Int)task->arg0 <= wanted)
+		{
+			taskStart(task);
+			started++;
+		}
+	}
+	while(started < wanted)
+	{
+		Task_Handle clone = xcalloc(sizeof(*clone));
+		*clone = model;
+		clone->arg0 = (UArg)++started;
+		clone->name = "clone";
+		taskStart(clone);
+	}
+	return started;
+}
+
+static Int staticRoleCount(HostRole role)
+{
+	Int n = 0;
+	Int i;
+	for(i = 0; i < hostTaskCount; i++)
+		n += hostTasks[i]->role == role;
+	return n;
+}
+
+static UInt64 hostStartNs;
+
+/*
+ Power report: active time is the virtual time not spent idle, plus PC_SIM_WAKE_CYCLES for
+ every wakeup of the idle CPU; the rest of the idle time is spent in PC_SIM_IDLE_MODE.
+ */
+static void powerReport(double elapsedSec)
+{
+	const char *mode = getenv("PC_SIM_IDLE_MODE");
+	double activeUA = envInt("PC_SIM_ACTIVE_UA", 2300);
+	double idleUA = activeUA;
+	double volts = envInt("PC_SIM_VCC_MV", 3000) / 1000.0;
+	UInt64 wokeNs = (UInt64)idleWakeups * wakeNs;
+	UInt64 sleepNs = idleNs > wokeNs ? idleNs - wokeNs : 0;
+	double activeSec = (simNow - sleepNs) / 1e9;
+	double chargeUC, items;
+
+	if(mode == NULL || *mode == '\0')
+		mode = "active";
+	if(strcmp(mode, "lpm0") == 0)
+		idleUA = envInt("PC_SIM_LPM0_UA", 80);
+	else if(strcmp(mode, "lpm3") == 0)
+		idleUA = envInt("PC_SIM_LPM3_UA", 2);
+	chargeUC = activeSec * activeUA + sleepNs / 1e9 * idleUA;
+	items = hostAppItems();
+	printf("power: tick=%s idle=%s duty=%.2f%% wakeups=%.0f/s avg current=%.1f uA",
+		   tickless ? "dynamic" : "periodic", mode, elapsedSec > 0 ? 100.0 * activeSec / elapsedSec : 0.0,
+		   elapsedSec > 0 ? idleWakeups / elapsedSec : 0.0, elapsedSec > 0 ? chargeUC / elapsedSec : 0.0);
+	if(items > 0)
+		printf(" energy/item=%.3f uJ", chargeUC * volts / items);
+	putchar('\n');
+}
+
+static void report(const char *reason)
+{
+	double elapsedSec = simNow / 1e9;
+	SimTask *t;
+	Int i;
+
+	printf("sim run: %.3f s virtual (%.3f s host), producers=%d consumers=%d, %s\n", elapsedSec,
+		   (hostNowNs() - hostStartNs) / 1e9, runProducers, runConsumers, reason);
+	hostAppReport(elapsedSec);
+	printf("buffer occupancy: avg=%.2f max=%d (sampled every tick)\n",
+		   simTick ? (double)occupancySum / simTick : 0.0, occupancyMax);
+	printf("cpu: idle=%.1f%% context switches=%lu\n", simNow ? 100.0 * idleNs / simNow : 0.0,
+		   (unsigned long)contextSwitches);
+	powerReport(elapsedSec);
+	printf("%-16s %12s %12s %14s %14s\n", "semaphore", "pends", "blocked", "avg wait us", "max wait us");
+	for(i = 0; i < hostSemaphoreCount; i++)
+	{
+		Semaphore_Handle sem = hostSemaphores[i];
+		double avgUs = sem->blockedPends ? sem->waitTotalNs / 1000.0 / sem->blockedPends : 0.0;
+		printf("%-16s %12lu %12lu %14.2f %14.2f\n", sem->name, (unsigned long)sem->pends,
+			   (unsigned long)sem->blockedPends, avgUs, sem->waitMaxNs / 1000.0);
+	}
+	printf("%-16s %5s %8s %12s\n", "task", "prio", "cpu %", "dispatches");
+	for(t = allTasks; t != NULL; t = t->nextTask)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "%s/%lu", t->handle->name, (unsigned long)t->handle->arg0);
+		printf("%-16s %5d %8.2f %12lu\n", name, t->handle->priority,
+			   simNow ? 100.0 * t->cpuNs / simNow : 0.0, (unsigned long)t->dispatches);
+	}
+	fflush(stdout);
+	_exit(EXIT_SUCCESS);
+}
+
+static Bool anyTimedWork(void)
+{
+	SimTask *t;
+	Int i;
+
+	for(i = 0; i < hostClockCount; i++)
+		if(((ClockBackend *)hostClocks[i]->backend)->running)
+			return TRUE;
+	for(t = allTasks; t != NULL; t = t->nextTask)
+		if(t->state == SimTask_BLOCKED && t->wakeTick != 0)
+			return TRUE;
+	return FALSE;
+}
+
+//The first tick at which a running Clock object or a Task_sleep/pend timeout is due
+static UInt64 nextDueTick(void)
+{
+	UInt64 due = 0;
+	SimTask *t;
+	Int i;
+
+	for(i = 0; i < hostClockCount; i++)
+	{
+		ClockBackend *cb = hostClocks[i]->backend;
+		if(cb->running && (due == 0 || cb->dueTick < due))
+			due = cb->dueTick;
+	}
+	for(t = allTasks; t != NULL; t = t->nextTask)
+		if(t->state == SimTask_BLOCKED && t->wakeTick != 0 && (due == 0 || t->wakeTick < due))
+			due = t->wakeTick;
+	return due > simTick ? due : simTick + 1;
+}
+
+void BIOS_start(void)
+{
+	UInt64 mclkKHz = (UInt64)envInt("PC_SIM_MCLK_KHZ", 8000);
+	SimTask *last = NULL;
+	Int i;
+
+	runProducers = envInt("PC_PRODUCERS", staticRoleCount(HostRole_PRODUCER));
+	runConsumers = envInt("PC_CONSUMERS", staticRoleCount(HostRole_CONSUMER));
+	endNs = (UInt64)envInt("PC_RUN_MS", 2000) * 1000000ull;
+	tickNs = (UInt64)Clock_tickPeriod * 1000ull;
+	callNs = (UInt64)envInt("PC_SIM_CALL_CYCLES", 200) * 1000000ull / mclkKHz;
+	switchNs = (UInt64)envInt("PC_SIM_SWITCH_CYCLES", 150) * 1000000ull / mclkKHz;
+	wakeNs = (UInt64)envInt("PC_SIM_WAKE_CYCLES", 150) * 1000000ull / mclkKHz;
+	tickless = envInt("PC_SIM_TICKLESS", 0);
+	if(callNs == 0)
+		callNs = 1;							//virtual time must move for spinning tasks
+	hostStartNs = hostNowNs();
+
+	for(i = 0; i < hostClockCount; i++)
+		if(hostClocks[i]->startFlag)
+		{
+			ClockBackend *cb = hostClocks[i]->backend;
+			cb->running = TRUE;
+			cb->dueTick = hostClocks[i]->timeout;
+		}
+	startRole(HostRole_SERVICE, staticRoleCount(HostRole_SERVICE));
+	runProducers = startRole(HostRole_PRODUCER, runProducers);
+	runConsumers = startRole(HostRole_CONSUMER, runConsumers);
+
+	for(;;)
+	{
+		Int priority = highestReadyPriority();
+		SimTask *t;
+
+		if(priority < 0)
+		{
+			UInt64 next;
+			if(!anyTimedWork())
+				report("deadlock: every task is blocked");
+			next = (tickless ? nextDueTick() : simTick + 1) * tickNs;
+			if(next > endNs)
+				next = endNs;
+			idleWakeups++;
+			idleNs += next - simNow;
+			advance(next - simNow);
+			yieldPending = FALSE;
+			continue;
+		}
+		t = queuePop(&readyQueues[priority]);
+		if(t != last)
+		{
+			contextSwitches++;
+			advance(switchNs);
+		}
+		t->state = SimTask_RUNNING;
+		t->dispatches++;
+		currentTask = t;
+		swapcontext(&schedContext, &t->context);
+		currentTask = NULL;
+		last = t;
+	}
+}
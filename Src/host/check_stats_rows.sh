@@ -0,0 +1,53 @@
+#!/bin/sh
+# Checks that every producer/consumer Task of a host run, clones included, reports its own
+# statsRows row: a clone which shared another Task's row (e.g. copied with that Task's Env)
+# would leave its ID out of the task table and double the other Task's counts.
+#
+#   ./check_stats_rows.sh [producers consumers]
+#
+# Builds nothing - run it after make (make check does both). Defaults to 8 producers and 8
+# consumers, i.e. six clones of each, and runs pc_host (several times - the copy races with
+# the Task it copies) and pc_sim. Exits 1 on the first run with a missing or shared row.
+
+PRODUCERS=${1:-8}
+CONSUMERS=${2:-8}
+HERE=$(cd "$(dirname "$0")" && pwd) || exit 1
+OUT=$(mktemp) || exit 1
+trap 'rm -f "$OUT"' EXIT
+
+check() {
+	if ! PC_PRODUCERS=$PRODUCERS PC_CONSUMERS=$CONSUMERS PC_RUN_MS=200 "$HERE/$1" >"$OUT" 2>&1; then
+		echo "check_stats_rows.sh: $1 failed:" >&2
+		cat "$OUT" >&2
+		exit 1
+	fi
+	#task table: name/ID produced consumed ... - one row per Task, each ID once per role
+	if ! awk -v producers="$PRODUCERS" -v consumers="$CONSUMERS" -v backend="$1" '
+			/^task +produced / { table = 1; next }
+			table && NF < 3 { table = 0 }
+			table && !/\// { table = 0 }
+			table {
+				id = substr($1, index($1, "/") + 1)
+				rows++
+				if($2 > 0) { produced[id]++; if(produced[id] > 1) bad = bad " producer " id " twice" }
+				if($3 > 0) { consumed[id]++; if(consumed[id] > 1) bad = bad " consumer " id " twice" }
+			}
+			END {
+				for(i = 1; i <= producers; i++)
+					if(!(i in produced)) bad = bad " producer " i " missing"
+				for(i = 1; i <= consumers; i++)
+					if(!(i in consumed)) bad = bad " consumer " i " missing"
+				if(rows != producers + consumers + 1)
+					bad = bad " " rows " rows"
+				if(bad != "") { print backend ":" bad; exit 1 }
+			}' "$OUT"; then
+		cat "$OUT" >&2
+		exit 1
+	fi
+}
+
+for run in 1 2 3 4 5; do
+	check pc_host
+done
+check pc_sim
+echo "check_stats_rows.sh: ${PRODUCERS}x$CONSUMERS rows distinct"
@@ -0,0 +1,26 @@
+/*
+ driverlib_host.c
+
+ GPIO part of the host driverlib stand-in (see include/driverlib.h).
+ */
+#include <driverlib.h>
+
+static volatile UInt16 portOut[GPIO_PORT_PJ + 1];
+volatile UInt32 hostGpioToggles[GPIO_PORT_PJ + 1];
+
+void GPIO_setAsOutputPin(uint8_t selectedPort, uint16_t selectedPins)
+{
+	(void)selectedPort;
+	(void)selectedPins;
+}
+
+void GPIO_setOutputLowOnPin(uint8_t selectedPort, uint16_t selectedPins)
+{
+	portOut[selectedPort] &= ~selectedPins;
+}
+
+void GPIO_toggleOutputOnPin(uint8_t selectedPort, uint16_t selectedPins)
+{
+	portOut[selectedPort] ^= selectedPins;
+	hostGpioToggles[selectedPort]++;
+}
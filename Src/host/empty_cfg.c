@@ -0,0 +1,344 @@
+/*
+ empty_cfg.c
+
+ Host build mirror of the statically created objects in empty.cfg (names, arg0, priorities,
+ semaphore modes and initial counts, Clock.tickPeriod and the timeSharingClk period).
+ Whenever empty.cfg changes, this file must follow.
+
+ It also holds the application-level part of the host report, since that is the only place
+ on the host side that knows about main.c's globals.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <xdc/cfg/global.h>
+#include <driverlib.h>
+#include "../task_stats.h"				//TaskStats_T, StatsSnapshot_T and their snapshot functions
+
+//Handler functions from main.c, as referenced by "&producerHandler" etc. in empty.cfg
+extern void producerHandler(UArg arg0, UArg arg1);
+extern void consumerHandler(UArg arg0, UArg arg1);
+extern void ledSrvTaskHandler(void);
+extern void tsClockHandler(void);
+extern void ledBlinkClkHandler(UArg arg);
+
+//main.c globals read by the report
+extern volatile UInt32 ledRequestsCoalesced;
+extern volatile UInt32 ledRequestsDropped;
+extern volatile UInt32 backpressureEvents __attribute__((weak));	//BACKPRESSURE builds only
+
+//Same layout as TimeSlice_T in main.c; timeSliceSnapshot is missing unless TIME_SLICE is TIME_SLICE_ADAPTIVE
+typedef struct
+{
+	UInt32 ticks;
+	UInt32 yields;
+	UInt32 kept;
+} HostTimeSlice;
+extern Bool timeSliceSnapshot(Int row, HostTimeSlice *slice) __attribute__((weak));
+
+//Same layout as TraceRecord_T in main.c; traceEntry is missing unless TRACE_SINK is TRACE_SINK_RING
+typedef struct
+{
+	UInt32 timestamp;
+	UInt16 arg1;
+	UInt16 arg2;
+	UInt8 event;
+	UInt8 task;
+} HostTraceRecord;
+extern Bool traceEntry(UInt32 index, HostTraceRecord *record) __attribute__((weak));
+
+//Log formats of the trace events, as in main.c
+static const char *const traceFormats[] = {
+#define TRACE_EVENT(name, level, category, format) format,
+#include "../trace_events.h"
+#undef TRACE_EVENT
+};
+
+//Same layout as LatencyStats_T in main.c; latencySnapshot is missing when LATENCY_STATS is 0
+typedef struct
+{
+	UInt32 count;
+	UInt32 p50;
+	UInt32 p99;
+	UInt32 p999;
+	UInt32 max;
+} HostLatencyStats;
+extern void latencySnapshot(HostLatencyStats *stats) __attribute__((weak));
+
+//Same layout as SemProfile_T in main.c; semProfileEntry is missing when SEM_PROFILE is 0
+typedef struct
+{
+	UInt32 acquired;
+	UInt32 blocked;
+	UInt32 failed;
+	UInt32 posts;
+	UInt64 waitTotal;
+	UInt32 waitMax;
+} HostSemProfile;
+extern Bool semProfileEntry(Int row, Int sem, Task_Handle *task, String *semName,
+							HostSemProfile *entry) __attribute__((weak));
+
+//-----------------------------------------
+// Clock module
+//-----------------------------------------
+const UInt32 Clock_tickPeriod = 500;
+
+//-----------------------------------------
+// Tasks (Task.defaultPriority is 1; ledSrvTask has priority 3)
+//-----------------------------------------
+static Task_Object producerTask1Obj = { "producerTask1", producerHandler, 1, 0, 1, HostRole_PRODUCER };
+static Task_Object consumerTask1Obj = { "consumerTask1", consumerHandler, 1, 0, 1, HostRole_CONSUMER };
+static Task_Object ledSrvTaskObj = { "ledSrvTask", (Task_FuncPtr)ledSrvTaskHandler, 0, 0, 3, HostRole_SERVICE };
+static Task_Object consumerTask2Obj = { "consumerTask2", consumerHandler, 2, 0, 1, HostRole_CONSUMER };
+static Task_Object producerTask2Obj = { "producerTask2", producerHandler, 2, 0, 1, HostRole_PRODUCER };
+
+Task_Handle producerTask1 = &producerTask1Obj;
+Task_Handle consumerTask1 = &consumerTask1Obj;
+Task_Handle ledSrvTask = &ledSrvTaskObj;
+Task_Handle consumerTask2 = &consumerTask2Obj;
+Task_Handle producerTask2 = &producerTask2Obj;
+
+Task_Object *const hostTasks[] = {
+	&producerTask1Obj, &consumerTask1Obj, &ledSrvTaskObj, &consumerTask2Obj, &producerTask2Obj
+};
+const Int hostTaskCount = sizeof(hostTasks) / sizeof(hostTasks[0]);
+
+//-----------------------------------------
+// Clocks
+//-----------------------------------------
+static Clock_Object timeSharingClkObj = { "timeSharingClk", (Clock_FuncPtr)tsClockHandler, 1, 1, TRUE, 0 };
+static Clock_Object ledBlinkClkObj = { "ledBlinkClk", ledBlinkClkHandler, 256, 0, FALSE, 0 };
+
+Clock_Handle timeSharingClk = &timeSharingClkObj;
+Clock_Handle ledBlinkClk = &ledBlinkClkObj;
+
+Clock_Object *const hostClocks[] = { &timeSharingClkObj, &ledBlinkClkObj };
+const Int hostClockCount = sizeof(hostClocks) / sizeof(hostClocks[0]);
+
+//-----------------------------------------
+// Semaphores
+//-----------------------------------------
+static Semaphore_Object fullSlotsObj = { "fullSlots", 0, Semaphore_Mode_COUNTING };
+static Semaphore_Object emptySlotsObj = { "emptySlots", 0, Semaphore_Mode_COUNTING };
+static Semaphore_Object mutexObj = { "mutex", 1, Semaphore_Mode_BINARY };
+static Semaphore_Object ledSrvSchedSemObj = { "ledSrvSchedSem", 0, Semaphore_Mode_BINARY };
+static Semaphore_Object setLedEnvMutexObj = { "setLedEnvMutex", 1, Semaphore_Mode_BINARY };
+static Semaphore_Object ledBlinkDoneSemObj = { "ledBlinkDoneSem", 0, Semaphore_Mode_BINARY };
+
+Semaphore_Handle fullSlots = &fullSlotsObj;
+Semaphore_Handle emptySlots = &emptySlotsObj;
+Semaphore_Handle mutex = &mutexObj;
+Semaphore_Handle ledSrvSchedSem = &ledSrvSchedSemObj;
+Semaphore_Handle setLedEnvMutex = &setLedEnvMutexObj;
+Semaphore_Handle ledBlinkDoneSem = &ledBlinkDoneSemObj;
+
+Semaphore_Object *const hostSemaphores[] = {
+	&fullSlotsObj, &emptySlotsObj, &mutexObj, &ledSrvSchedSemObj, &setLedEnvMutexObj,
+	&ledBlinkDoneSemObj
+};
+const Int hostSemaphoreCount = sizeof(hostSemaphores) / sizeof(hostSemaphores[0]);
+
+//-----------------------------------------
+// Application report
+//-----------------------------------------
+
+//Per-Task split of the semaphore figures (SEM_PROFILE), in Timestamp units converted to us
+static void semProfileReport(void)
+{
+	Types_FreqHz freq;
+	double usPerTick;
+	Task_Handle task;
+	String semName;
+	HostSemProfile entry;
+	Int row, sem;
+
+	Timestamp_getFreq(&freq);
+	usPerTick = 1e6 / ((double)freq.hi * 4294967296.0 + freq.lo);
+	printf("%-18s %-16s %10s %10s %8s %10s %12s %12s\n", "task", "semaphore", "acquired",
+		   "blocked", "failed", "posts", "avg wait us", "max wait us");
+	for(row = 0; semProfileEntry(row, 0, &task, &semName, &entry); row++)
+		for(sem = 0; semProfileEntry(row, sem, &task, &semName, &entry); sem++)
+		{
+			char name[32];
+			if(entry.acquired + entry.failed + entry.posts == 0)
+				continue;
+			snprintf(name, sizeof(name), "%s/%lu", task->name, (unsigned long)task->arg0);
+			printf("%-18s %-16s %10lu %10lu %8lu %10lu %12.2f %12.2f\n", name, semName,
+				   (unsigned long)entry.acquired, (unsigned long)entry.blocked,
+				   (unsigned long)entry.failed, (unsigned long)entry.posts,
+				   entry.blocked ? entry.waitTotal * usPerTick / entry.blocked : 0.0,
+				   entry.waitMax * usPerTick);
+		}
+}
+
+//Per-Task counters (statsTaskSnapshot)
+static void statsReport(void)
+{
+	Task_Handle task;
+	TaskStats_T row;
+	Int i;
+
+	printf("%-18s %10s %10s %8s %8s %10s %10s %9s %8s %8s %8s\n", "task", "produced",
+		   "consumed", "ins err", "rem err", "led posted", "led served", "throttled", "shed",
+		   "timeouts", "dl miss");
+	for(i = 0; statsTaskSnapshot(i, &task, &row); i++)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "%s/%lu", task->name, (unsigned long)task->arg0);
+		printf("%-18s %10lu %10lu %8lu %8lu %10lu %10lu %9lu %8lu %8lu %8lu\n", name,
+			   (unsigned long)row.produced, (unsigned long)row.consumed,
+			   (unsigned long)row.insertErrors, (unsigned long)row.removeErrors,
+			   (unsigned long)row.ledPosted, (unsigned long)row.ledServed,
+			   (unsigned long)row.throttled, (unsigned long)row.shed,
+			   (unsigned long)row.timeouts, (unsigned long)row.deadlineMisses);
+	}
+}
+
+//Per-Task time slicing (timeSliceSnapshot): ticks run, yields forced, yields saved
+static void timeSliceReport(void)
+{
+	Task_Handle task;
+	TaskStats_T unused;
+	HostTimeSlice slice;
+	Int i;
+
+	if(timeSliceSnapshot == NULL)
+		return;
+	printf("%-18s %10s %10s %10s\n", "time slice", "ticks", "yields", "kept");
+	for(i = 0; statsTaskSnapshot(i, &task, &unused) && timeSliceSnapshot(i, &slice); i++)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "%s/%lu", task->name, (unsigned long)task->arg0);
+		printf("%-18s %10lu %10lu %10lu\n", name, (unsigned long)slice.ticks,
+			   (unsigned long)slice.yields, (unsigned long)slice.kept);
+	}
+}
+
+//Little endian store of the low "bytes" bytes of v
+static void putLE(FILE *f, UInt32 v, Int bytes)
+{
+	while(bytes-- > 0)
+	{
+		putc(v & 0xFF, f);
+		v >>= 8;
+	}
+}
+
+/*
+ The trace ring (TRACE_SINK_RING): PC_TRACE=1 prints it, decoded as host/trace_decode.c does;
+ PC_TRACE_FILE=<file> saves it in the MSP430 layout of traceBuffer, for trace_decode - the
+ records oldest first, so the saved head is the number of records.
+ */
+static void traceReport(void)
+{
+	const char *fileName = getenv("PC_TRACE_FILE");
+	const char *print = getenv("PC_TRACE");
+	HostTraceRecord r;
+	UInt32 i;
+	FILE *f = NULL;
+
+	if(fileName != NULL && (f = fopen(fileName, "wb")) == NULL)
+		perror(fileName);
+	if(f != NULL)
+	{
+		for(i = 0; traceEntry(i, &r); i++)
+			;
+		putLE(f, i, 4);
+	}
+	for(i = 0; traceEntry(i, &r); i++)
+	{
+		if(f != NULL)
+		{
+			putLE(f, r.timestamp, 4);
+			putLE(f, r.arg1, 2);
+			putLE(f, r.arg2, 2);
+			putLE(f, r.event, 1);
+			putLE(f, r.task, 1);
+		}
+		if(print != NULL && atoi(print) != 0)
+		{
+			Task_Handle task = NULL;
+			TaskStats_T unused;
+
+			if(r.task == 0 || !statsTaskSnapshot(r.task - 1, &task, &unused))
+				task = NULL;
+			printf("[%10lu] %-18s ", (unsigned long)r.timestamp, task != NULL ? task->name : "-");
+			if(r.event < sizeof(traceFormats) / sizeof(traceFormats[0]))
+				Log_host_format(traceFormats[r.event], r.arg1, r.arg2);
+			else
+				printf("unknown event %u\n", r.event);
+		}
+	}
+	if(f != NULL)
+		fclose(f);
+}
+
+void hostAppReport(double elapsedSec)
+{
+	StatsSnapshot_T stats;
+	Int32 inBuffer;
+
+	statsSnapshot(&stats);
+	if(stats.untracked > 0)
+	{
+		//their items are missing from every total below - a wrong figure is worse than none
+		fprintf(stderr, "error: %d tasks not counted - raise STATS_TASKS (make STATS_TASKS=n)\n",
+				stats.untracked);
+		exit(EXIT_FAILURE);
+	}
+	//a consumer can count an item before its producer does (see hostAppOccupancy)
+	inBuffer = (Int32)(stats.total.produced - stats.total.consumed);
+	printf("items: produced=%lu consumed=%lu in buffer=%ld errors: insert=%lu remove=%lu\n",
+		   (unsigned long)stats.total.produced, (unsigned long)stats.total.consumed,
+		   (long)(inBuffer > 0 ? inBuffer : 0),
+		   (unsigned long)stats.total.insertErrors, (unsigned long)stats.total.removeErrors);
+	printf("throughput: %.0f items/sec\n", stats.total.consumed / elapsedSec);
+	printf("led toggles: green=%lu red=%lu\n",
+		   (unsigned long)hostGpioToggles[GPIO_PORT_P4], (unsigned long)hostGpioToggles[GPIO_PORT_P1]);
+	printf("led requests: posted=%lu served=%lu coalesced=%lu dropped=%lu\n",
+		   (unsigned long)stats.total.ledPosted, (unsigned long)stats.total.ledServed,
+		   (unsigned long)ledRequestsCoalesced, (unsigned long)ledRequestsDropped);
+	if(&backpressureEvents != NULL)
+		printf("backpressure: turned on %lu times, throttled=%lu shed=%lu\n",
+			   (unsigned long)backpressureEvents, (unsigned long)stats.total.throttled,
+			   (unsigned long)stats.total.shed);
+	if(stats.total.timeouts != 0 || stats.total.deadlineMisses != 0)
+		printf("deadlines: timeouts=%lu misses=%lu\n", (unsigned long)stats.total.timeouts,
+			   (unsigned long)stats.total.deadlineMisses);
+	statsReport();
+	timeSliceReport();
+	if(latencySnapshot != NULL)
+	{
+		HostLatencyStats stats;
+		Types_FreqHz freq;
+		double usPerTick;
+
+		latencySnapshot(&stats);
+		Timestamp_getFreq(&freq);
+		usPerTick = 1e6 / ((double)freq.hi * 4294967296.0 + freq.lo);
+		printf("item latency us: items=%lu p50=%.1f p99=%.1f p999=%.1f max=%.1f\n",
+			   (unsigned long)stats.count, stats.p50 * usPerTick, stats.p99 * usPerTick,
+			   stats.p999 * usPerTick, stats.max * usPerTick);
+	}
+	if(semProfileEntry != NULL)
+		semProfileReport();
+	if(traceEntry != NULL)
+		traceReport();
+}
+
+UInt32 hostAppItems(void)
+{
+	StatsSnapshot_T stats;
+
+	statsSnapshot(&stats);
+	return stats.total.consumed;
+}
+
+Int hostAppOccupancy(void)
+{
+	StatsSnapshot_T stats;
+	Int32 inBuffer;
+
+	statsSnapshot(&stats);
+	inBuffer = (Int32)(stats.total.produced - stats.total.consumed);
+	return inBuffer > 0 ? inBuffer : 0;	//rows are read one after the other (see statsSnapshot)
+}
@@ -0,0 +1,219 @@
+/*
+ bios_host.h
+
+ Host (Linux) stand-in for the small part of SYS/BIOS and XDC runtime that main.c uses.
+ The BIOS headers under host/include (xdc/std.h, ti/sysbios/BIOS.h, ...) all include this
+ file, so main.c compiles unchanged - only the include path differs from the CCS build.
+
+ The kernel objects themselves (producerTask1, fullSlots, timeSharingClk, ...) are described
+ by the generic structures below and are statically defined in empty_cfg.c, which mirrors
+ empty.cfg. The backend gives them their run-time behaviour: bios_posix.c runs them on
+ pthreads at full speed (pc_host), bios_sim.c simulates the BIOS scheduler in virtual
+ time (pc_sim).
+ */
+#ifndef BIOS_HOST_H
+#define BIOS_HOST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+//-----------------------------------------
+// xdc/std.h types
+//-----------------------------------------
+typedef int Int;
+typedef unsigned int UInt;
+typedef int Bool;
+typedef char Char;
+typedef unsigned char UChar;
+typedef short Short;
+typedef unsigned short UShort;
+typedef long Long;
+typedef unsigned long ULong;
+typedef char *String;
+typedef void *Ptr;
+typedef uintptr_t UArg;
+typedef intptr_t IArg;
+typedef int8_t Int8;
+typedef uint8_t UInt8;
+typedef int16_t Int16;
+typedef uint16_t UInt16;
+typedef int32_t Int32;
+typedef uint32_t UInt32;
+typedef int64_t Int64;
+typedef uint64_t UInt64;
+typedef uint16_t Bits16;
+typedef uint32_t Bits32;
+typedef void Void;
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+//-----------------------------------------
+// BIOS
+//-----------------------------------------
+#define BIOS_WAIT_FOREVER (~(UInt32)0)
+#define BIOS_NO_WAIT ((UInt32)0)
+
+void BIOS_start(void);
+
+//-----------------------------------------
+// Task
+//-----------------------------------------
+typedef void (*Task_FuncPtr)(UArg arg0, UArg arg1);
+
+//Role of a statically created Task - lets the host replicate producers/consumers on demand
+typedef enum
+{
+	HostRole_SERVICE,
+	HostRole_PRODUCER,
+	HostRole_CONSUMER
+} HostRole;
+
+typedef struct Task_Object
+{
+	const char *name;
+	Task_FuncPtr fxn;
+	UArg arg0;
+	UArg arg1;
+	Int priority;
+	HostRole role;
+	Ptr env;
+	Ptr backend;
+} Task_Object, *Task_Handle;
+
+Task_Handle Task_self(void);
+void Task_yield(void);
+void Task_sleep(UInt32 nticks);
+void Task_setEnv(Task_Handle handle, Ptr env);
+Ptr Task_getEnv(Task_Handle handle);
+String Task_Handle_name(Task_Handle handle);
+
+Int Task_getPri(Task_Handle handle);
+Int Task_setPri(Task_Handle handle, Int newpri);
+
+typedef enum
+{
+	Task_Mode_RUNNING,
+	Task_Mode_READY,
+	Task_Mode_BLOCKED,
+	Task_Mode_TERMINATED,
+	Task_Mode_INACTIVE
+} Task_Mode;
+
+//Task_stat - pc_sim fills in the mode and measures the stack used; pc_host reports every Task
+//as ready and no stack use
+typedef struct Task_Stat
+{
+	Int priority;
+	Ptr stack;
+	size_t stackSize;
+	Ptr stackHeap;
+	Ptr env;
+	Task_Mode mode;
+	Ptr sp;
+	size_t used;
+} Task_Stat;
+
+void Task_stat(Task_Handle handle, Task_Stat *statbuf);
+Task_Mode Task_getMode(Task_Handle handle);	//as Task_stat's mode, without the stack scan
+Task_Handle Task_getIdleTask(void);			//NULL - the host has no idle Task
+
+//-----------------------------------------
+// Semaphore
+//-----------------------------------------
+typedef enum
+{
+	Semaphore_Mode_COUNTING,
+	Semaphore_Mode_BINARY
+} Semaphore_Mode;
+
+typedef struct Semaphore_Object
+{
+	const char *name;
+	Int count;
+	Semaphore_Mode mode;
+	//pend statistics, maintained by the backend
+	UInt32 pends;
+	UInt32 blockedPends;
+	UInt64 waitTotalNs;
+	UInt64 waitMaxNs;
+	Ptr backend;
+} Semaphore_Object, *Semaphore_Handle;
+
+Bool Semaphore_pend(Semaphore_Handle handle, UInt32 timeout);
+void Semaphore_post(Semaphore_Handle handle);
+Int Semaphore_getCount(Semaphore_Handle handle);
+void Semaphore_reset(Semaphore_Handle handle, Int count);
+
+//-----------------------------------------
+// Clock
+//-----------------------------------------
+typedef void (*Clock_FuncPtr)(UArg arg);
+
+typedef struct Clock_Object
+{
+	const char *name;
+	Clock_FuncPtr fxn;
+	UInt32 timeout;
+	UInt32 period;
+	Bool startFlag;
+	UArg arg;
+	Ptr backend;
+} Clock_Object, *Clock_Handle;
+
+//Clock.tickPeriod in microseconds (set by empty_cfg.c, as in empty.cfg)
+extern const UInt32 Clock_tickPeriod;
+
+UInt32 Clock_getTicks(void);
+void Clock_start(Clock_Handle handle);
+void Clock_stop(Clock_Handle handle);
+void Clock_setTimeout(Clock_Handle handle, UInt32 timeout);
+
+//-----------------------------------------
+// Timestamp
+//-----------------------------------------
+typedef struct Types_FreqHz
+{
+	Bits32 hi;
+	Bits32 lo;
+} Types_FreqHz;
+
+//Nanoseconds: real ones in bios_posix.c, virtual ones in bios_sim.c
+UInt32 Timestamp_get32(void);
+void Timestamp_getFreq(Types_FreqHz *freq);
+
+//-----------------------------------------
+// Log
+//-----------------------------------------
+void Log_host_print(const char *fmt, UArg a1, UArg a2);
+//printf of fmt and the two arguments plus a newline - shared by the backends (log_host.c)
+void Log_host_format(const char *fmt, UArg a1, UArg a2);
+
+#define Log_info0(fmt) Log_host_print((fmt), 0, 0)
+#define Log_info1(fmt, a1) Log_host_print((fmt), (UArg)(a1), 0)
+#define Log_info2(fmt, a1, a2) Log_host_print((fmt), (UArg)(a1), (UArg)(a2))
+
+//-----------------------------------------
+// Static configuration (empty_cfg.c)
+//-----------------------------------------
+extern Task_Object *const hostTasks[];
+extern const Int hostTaskCount;
+extern Semaphore_Object *const hostSemaphores[];
+extern const Int hostSemaphoreCount;
+extern Clock_Object *const hostClocks[];
+extern const Int hostClockCount;
+
+//Application-level report appended to the backend's report (items/sec etc.)
+void hostAppReport(double elapsedSec);
+
+//Items currently in the buffer - sampled by the simulator (bios_sim.c) on every Clock tick
+Int hostAppOccupancy(void);
+
+//Items consumed so far - the simulator's energy per item
+UInt32 hostAppItems(void);
+
+#endif /* BIOS_HOST_H */
@@ -0,0 +1,49 @@
+/*
+ Host build stand-in for MSPWare's <driverlib.h>.
+
+ Only the calls made by main.c exist. Clock and watchdog set-up are no-ops; GPIO pins are
+ kept as plain port images so LED activity can still be counted by the host report.
+ */
+#ifndef HOST_DRIVERLIB_H
+#define HOST_DRIVERLIB_H
+
+#include "bios_host.h"
+
+#define GPIO_PORT_P1 1
+#define GPIO_PORT_P2 2
+#define GPIO_PORT_P3 3
+#define GPIO_PORT_P4 4
+#define GPIO_PORT_P5 5
+#define GPIO_PORT_P6 6
+#define GPIO_PORT_PJ 13
+
+#define GPIO_PIN0 (0x0001)
+#define GPIO_PIN1 (0x0002)
+#define GPIO_PIN2 (0x0004)
+#define GPIO_PIN3 (0x0008)
+#define GPIO_PIN4 (0x0010)
+#define GPIO_PIN5 (0x0020)
+#define GPIO_PIN6 (0x0040)
+#define GPIO_PIN7 (0x0080)
+
+#define WDT_A_BASE 0
+#define UCS_FLLREF 0
+#define UCS_REFOCLK_SELECT 0
+#define UCS_CLOCK_DIVIDER_1 1
+#define UCS_REFOCLK_FREQUENCY 32768
+
+//Number of GPIO_toggleOutputOnPin calls, per port
+extern volatile UInt32 hostGpioToggles[GPIO_PORT_PJ + 1];
+
+void GPIO_setAsOutputPin(uint8_t selectedPort, uint16_t selectedPins);
+void GPIO_setOutputLowOnPin(uint8_t selectedPort, uint16_t selectedPins);
+void GPIO_toggleOutputOnPin(uint8_t selectedPort, uint16_t selectedPins);
+
+#define WDT_A_hold(baseAddress) ((void)(baseAddress))
+#define UCS_initClockSignal(signal, source, divider) ((void)0)
+#define UCS_initFLLSettle(fsystem, ratio) ((void)0)
+
+//The host runs at full speed - busy-wait delays cost nothing
+#define __delay_cycles(cycles) ((void)0)
+
+#endif
@@ -0,0 +1,7 @@
+/* Host build stand-in for <ti/sysbios/BIOS.h> - see bios_host.h */
+#ifndef HOST_TI_SYSBIOS_BIOS_H
+#define HOST_TI_SYSBIOS_BIOS_H
+
+#include "bios_host.h"
+
+#endif
@@ -0,0 +1,7 @@
+/* Host build stand-in for <ti/sysbios/knl/Clock.h> - see bios_host.h */
+#ifndef HOST_TI_SYSBIOS_KNL_CLOCK_H
+#define HOST_TI_SYSBIOS_KNL_CLOCK_H
+
+#include "bios_host.h"
+
+#endif
@@ -0,0 +1,7 @@
+/* Host build stand-in for <ti/sysbios/knl/Task.h> - see bios_host.h */
+#ifndef HOST_TI_SYSBIOS_KNL_TASK_H
+#define HOST_TI_SYSBIOS_KNL_TASK_H
+
+#include "bios_host.h"
+
+#endif
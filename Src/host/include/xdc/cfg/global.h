@@ -0,0 +1,26 @@
+/*
+ Host build stand-in for <xdc/cfg/global.h>: the statically created objects of empty.cfg.
+ They are defined in empty_cfg.c - keep both files in step with empty.cfg.
+ */
+#ifndef HOST_XDC_CFG_GLOBAL_H
+#define HOST_XDC_CFG_GLOBAL_H
+
+#include "bios_host.h"
+
+extern Task_Handle producerTask1;
+extern Task_Handle producerTask2;
+extern Task_Handle consumerTask1;
+extern Task_Handle consumerTask2;
+extern Task_Handle ledSrvTask;
+
+extern Clock_Handle timeSharingClk;
+extern Clock_Handle ledBlinkClk;
+
+extern Semaphore_Handle fullSlots;
+extern Semaphore_Handle emptySlots;
+extern Semaphore_Handle mutex;
+extern Semaphore_Handle ledSrvSchedSem;
+extern Semaphore_Handle setLedEnvMutex;
+extern Semaphore_Handle ledBlinkDoneSem;
+
+#endif
@@ -0,0 +1,7 @@
+/* Host build stand-in for <xdc/runtime/Log.h> - see bios_host.h */
+#ifndef HOST_XDC_RUNTIME_LOG_H
+#define HOST_XDC_RUNTIME_LOG_H
+
+#include "bios_host.h"
+
+#endif
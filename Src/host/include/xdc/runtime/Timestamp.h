@@ -0,0 +1,7 @@
+/* Host build stand-in for <xdc/runtime/Timestamp.h> - see bios_host.h */
+#ifndef HOST_XDC_RUNTIME_TIMESTAMP_H
+#define HOST_XDC_RUNTIME_TIMESTAMP_H
+
+#include "bios_host.h"
+
+#endif
@@ -0,0 +1,7 @@
+/* Host build stand-in for <xdc/std.h> - see bios_host.h */
+#ifndef HOST_XDC_STD_H
+#define HOST_XDC_STD_H
+
+#include "bios_host.h"
+
+#endif
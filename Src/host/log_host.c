@@ -0,0 +1,47 @@
+/*
+ log_host.c
+
+ Log_info formatting shared by the host backends (bios_posix.c, bios_sim.c): the Log
+ arguments arrive as UArg, so each one is passed to printf as the type its conversion
+ expects - a string for %s, an unsigned int otherwise.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "bios_host.h"
+
+//Conversion character of the n-th (0-based) conversion in fmt, or 0 if there is none
+static char conversion(const char *fmt, Int n)
+{
+	const char *p = fmt;
+
+	while((p = strchr(p, '%')) != NULL)
+	{
+		p++;
+		if(*p == '%')
+		{
+			p++;
+			continue;
+		}
+		p += strspn(p, "-+ #0123456789.lhz");
+		if(n-- == 0)
+			return *p;
+	}
+	return 0;
+}
+
+void Log_host_format(const char *fmt, UArg a1, UArg a2)
+{
+	Bool s1 = conversion(fmt, 0) == 's';
+	Bool s2 = conversion(fmt, 1) == 's';
+
+	if(s1 && s2)
+		printf(fmt, (const char *)a1, (const char *)a2);
+	else if(s1)
+		printf(fmt, (const char *)a1, (unsigned int)a2);
+	else if(s2)
+		printf(fmt, (unsigned int)a1, (const char *)a2);
+	else
+		printf(fmt, (unsigned int)a1, (unsigned int)a2);
+	putchar('\n');
+}
@@ -0,0 +1,153 @@
+#!/bin/sh
+# Memory budget of the target build: reads the linker map of the CCS project (TI MSP430 linker)
+# and breaks the RAM and flash use down by subsystem - Task stacks, system stack, loggers,
+# CIO, Text tables, kernel objects, the data buffer and its per-item metadata, the trace ring,
+# application, driverlib, C runtime, .cinit tables and alignment holes.
+#
+#   ./mem_budget.sh [-m ram_memory] [-f min_free_bytes] [file.map]
+#
+#   -m  name of the RAM range in the map's MEMORY CONFIGURATION (default RAM);
+#   -f  fail (exit status 1) if less than this many bytes of it are left - run it as a CCS
+#       post-build step (e.g. ../host/mem_budget.sh -f 256 ${BuildArtifactFileBaseName}.map)
+#       to keep a change from eating the headroom unnoticed.
+#
+# The map defaults to ../Debug/*.map. Every input section is attributed to the memory range
+# holding its address, so .data counts in RAM and its .cinit image in flash.
+
+RAM=RAM
+MIN_FREE=
+while getopts m:f: opt; do
+	case $opt in
+	m) RAM=$OPTARG ;;
+	f) MIN_FREE=$OPTARG ;;
+	*) sed -n '7p' "$0" >&2; exit 2 ;;
+	esac
+done
+shift $((OPTIND - 1))
+HERE=$(cd "$(dirname "$0")" && pwd) || exit 1
+MAP=${1:-$(ls "$HERE"/../Debug/*.map 2>/dev/null | head -n 1)}
+if [ ! -r "$MAP" ]; then
+	echo "mem_budget.sh: no map file${MAP:+ $MAP}" >&2
+	exit 2
+fi
+
+awk -v ram="$RAM" -v minFree="$MIN_FREE" '
+	function hex(s,    i, v) {
+		v = 0
+		s = tolower(s)
+		for(i = 1; i <= length(s); i++)
+			v = v * 16 + index("0123456789abcdef", substr(s, i, 1)) - 1
+		return v
+	}
+	function memoryOf(addr,    m) {
+		for(m = 1; m <= nmem; m++)
+			if(addr >= memOrigin[m] && addr < memOrigin[m] + memLength[m])
+				return memName[m]
+		return ""
+	}
+	#Subsystem of an input section: output section, object (library : member) and the
+	#input section or .common symbol name
+	function category(out, obj, sec,    sym) {
+		sym = sec
+		sub(/^[^:]*:/, "", sym)
+		if(out == ".stack")
+			return "system stack"
+		if(out == ".sysmem")
+			return "heap"
+		if(out == ".cinit")
+			return "init tables"
+		if(out == ".cio" || obj ~ /trgmsg/ || sym ~ /^(parmbuf|_CIOBUF_)$/)
+			return "CIO"
+		if(sec ~ /taskStackSection/ || sym ~ /Task_Instance_State_.*stack/)
+			return "task stacks"
+		if(sec ~ /Logger|LoggingSetup|SysMin|utils_Load|ti_uia/ || obj ~ /ti\.uia/)
+			return "loggers"
+		if(sym ~ /Text_(charTab|nodeTab)/)
+			return "text tables"
+		if(sym == "buffer")
+			return "data buffer"
+		if(sym ~ /^(slotFull|slotSeq|slotStamp)$/)
+			return "item metadata"
+		if(sym == "traceBuffer")
+			return "trace ring"
+		if(obj ~ /main\.obj/ || sec ~ /^\.common:/)
+			return "application"
+		if(obj ~ /empty_p|sysbios|ti\.targets|xdc/ || sec ~ /ti_sysbios|xdc_runtime/)
+			return "kernel objects"
+		if(obj ~ /MSP430F5529|driverlib/)
+			return "driverlib"
+		if(obj ~ /rts430|boot|\.lib/)
+			return "C runtime"
+		return "other"
+	}
+	function report(title, where,    c, total) {
+		total = 0
+		for(c = 1; c <= ncat; c++)
+			total += bytes[where, cats[c]]
+		printf "%s\n", title
+		for(c = 1; c <= ncat; c++)
+			if(bytes[where, cats[c]] > 0)
+				printf "  %-16s %6d  %5.1f%%\n", cats[c], bytes[where, cats[c]],
+					   bytes[where, cats[c]] * 100.0 / total
+		printf "  %-16s %6d\n", "total", total
+	}
+	BEGIN {
+		ncat = split("task stacks,system stack,heap,loggers,CIO,text tables,kernel objects," \
+					 "data buffer,item metadata,trace ring,application,driverlib,C runtime,init tables," \
+					 "holes,other", cats, ",")
+	}
+	/^MEMORY CONFIGURATION/ { inMemory = 1; next }
+	/^SECTION ALLOCATION MAP/ { inMemory = 0; inSections = 1; next }
+	/^(LINKER GENERATED|GLOBAL SYMBOLS)/ { inSections = 0 }
+	inMemory && NF >= 5 && $2 ~ /^[0-9a-fA-F]+$/ && $3 ~ /^[0-9a-fA-F]+$/ {
+		nmem++
+		memName[nmem] = $1
+		memOrigin[nmem] = hex($2)
+		memLength[nmem] = hex($3)
+		memUsed[$1] = hex($4)
+		memSize[$1] = hex($3)
+	}
+	!inSections { next }
+	/^[^ *]/ { out = $1 }
+	/^ +[0-9a-fA-F]+ +[0-9a-fA-F]+ / {
+		addr = hex($1)
+		len = hex($2)
+		line = $0
+		sub(/^ +[0-9a-fA-F]+ +[0-9a-fA-F]+ +/, "", line)
+		if(line ~ /^--HOLE--/)
+			cat = (out == ".stack") ? "system stack" : "holes"
+		else
+		{
+			sec = ""
+			if(match(line, /\([^)]*\)/))
+				sec = substr(line, RSTART + 1, RLENGTH - 2)
+			obj = substr(line, 1, RSTART > 0 ? RSTART - 1 : length(line))
+			#"  : member.obj" continues the library of the line above
+			if(obj ~ /^ *:/)
+				obj = lib obj
+			else if(obj ~ /:/)
+				lib = substr(obj, 1, index(obj, ":") - 1)
+			cat = category(out, obj, sec)
+		}
+		where = memoryOf(addr)
+		if(where == ram)
+			bytes["RAM", cat] += len
+		else if(where ~ /^FLASH/)
+			bytes["FLASH", cat] += len
+	}
+	END {
+		if(!(ram in memSize))
+		{
+			printf "mem_budget.sh: no memory range %s in the map\n", ram > "/dev/stderr"
+			exit 2
+		}
+		report(sprintf("%s: %d of %d bytes used, %d free", ram, memUsed[ram], memSize[ram],
+					   memSize[ram] - memUsed[ram]), "RAM")
+		report("FLASH (all FLASH ranges):", "FLASH")
+		if(minFree != "" && memSize[ram] - memUsed[ram] < minFree + 0)
+		{
+			printf "mem_budget.sh: %s has %d bytes free, budget is %d\n", ram,
+				   memSize[ram] - memUsed[ram], minFree > "/dev/stderr"
+			exit 1
+		}
+	}' "$MAP"
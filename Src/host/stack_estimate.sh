@@ -0,0 +1,130 @@
+#!/bin/sh
+# Static worst-case stack estimate of the Task and Clock functions of ../main.c: compiles it
+# with GCC's -fcallgraph-info=su (the frame size of every function and the static call graph)
+# and walks the graph from each entry function to its deepest call path.
+#
+#   ./stack_estimate.sh [entry ...]
+#
+# The entries default to the Task functions (producerHandler, consumerHandler,
+# ledSrvTaskHandler) and the Clock functions (tsClockHandler, ledBlinkClkHandler). CC, CFLAGS
+# and DEFS select the compiler and the build options as for the Makefile - for figures
+# close to the target use the MSP430 GCC and its include paths, e.g.
+#
+#   CC=msp430-elf-gcc CFLAGS="-Os -mmcu=msp430fr5969 -I<bios/xdc/driverlib includes>" ./stack_estimate.sh
+#
+# The default (host cc, include/ stand-in) gives the shape of the call graph but host frame
+# sizes. Calls into BIOS, xdc and driverlib are leaves of unknown cost here: they are listed per
+# entry and their own depth (see the SYS/BIOS "Stack usage" tables) has to be added, as has the
+# Task switch context. Calls through function pointers are not seen. A "dynamic" frame
+# (alloca, variable length array) or a recursive path is flagged, as the estimate is not an
+# upper bound then. Confirm the result on target with stackDump (STACK_DUMP_EVERY in main.c).
+
+CC=${CC:-cc}
+CFLAGS=${CFLAGS:-"-O2"}
+HERE=$(cd "$(dirname "$0")" && pwd) || exit 1
+TMP=$(mktemp -d) || exit 1
+trap 'rm -rf "$TMP"' EXIT
+
+ENTRIES=${*:-"producerHandler consumerHandler ledSrvTaskHandler tsClockHandler ledBlinkClkHandler"}
+# shellcheck disable=SC2086
+$CC -I"$HERE/include" $DEFS $CFLAGS -fcallgraph-info=su -c "$HERE/../main.c" -o "$TMP/main.o" ||
+	exit 1
+
+awk -v entries="$ENTRIES" '
+	function field(line, name,    s) {
+		s = substr(line, index(line, name ": \"") + length(name) + 3)
+		return substr(s, 1, index(s, "\"") - 1)
+	}
+	#Worst-case depth below f (f included); sets worstPath[f]
+	function depth(f,    i, c, d, best, bestPath) {
+		if(f in memo)
+			return memo[f]
+		if(active[f])
+		{
+			cycle[f] = 1
+			return 0
+		}
+		if(!(f in frame))
+		{
+			worstPath[f] = f "(?)"
+			return 0
+		}
+		active[f] = 1
+		best = 0
+		bestPath = ""
+		for(i = 1; i <= ncallees[f]; i++)
+		{
+			c = callee[f, i]
+			d = depth(c)
+			if(d > best || bestPath == "")
+			{
+				best = d
+				bestPath = worstPath[c]
+			}
+		}
+		active[f] = 0
+		worstPath[f] = f "(" frame[f] ")" (bestPath != "" ? " > " bestPath : "")
+		memo[f] = frame[f] + best
+		return memo[f]
+	}
+	#External callees, dynamic frames and recursion reachable from f
+	function reachable(f,    i) {
+		if(f in seen)
+			return
+		seen[f] = 1
+		if(!(f in frame))
+		{
+			list = list " " f
+			return
+		}
+		if(kind[f] != "static")
+			dynamic = dynamic " " f "(" kind[f] ")"
+		if(f in cycle)
+			recursive = recursive " " f
+		for(i = 1; i <= ncallees[f]; i++)
+			reachable(callee[f, i])
+	}
+	/^node:/ && !/shape : ellipse/ {
+		name = field($0, "title")
+		label = field($0, "label")
+		if(match(label, /[0-9]+ bytes \([a-z,]+\)/))
+		{
+			split(substr(label, RSTART, RLENGTH), w, /[ ()]+/)
+			frame[name] = w[1]
+			kind[name] = w[3]
+		}
+	}
+	/^edge:/ {
+		from = field($0, "sourcename")
+		to = field($0, "targetname")
+		if(!((from, to) in edge))
+		{
+			edge[from, to] = 1
+			callee[from, ++ncallees[from]] = to
+		}
+	}
+	END {
+		n = split(entries, entry, " ")
+		for(e = 1; e <= n; e++)
+		{
+			f = entry[e]
+			if(!(f in frame))
+			{
+				printf "%s: not found\n", f
+				continue
+			}
+			recursive = ""
+			dynamic = ""
+			list = ""
+			split("", seen)
+			printf "%s: %d bytes\n", f, depth(f)
+			printf "  path: %s\n", worstPath[f]
+			reachable(f)
+			if(list != "")
+				printf "  plus unknown:%s\n", list
+			if(dynamic != "")
+				printf "  dynamic frames:%s\n", dynamic
+			if(recursive != "")
+				printf "  RECURSION:%s\n", recursive
+		}
+	}' "$TMP"/main.ci
@@ -0,0 +1,130 @@
+/*
+ trace_decode.c
+
+ Host decoder of the main.c trace ring (TRACE_SINK_RING): reads a binary image of traceBuffer -
+ saved from the CCS memory browser of a halted target, or written by pc_host/pc_sim with
+ PC_TRACE_FILE - and prints its records, oldest first, as the Log messages they stand for
+ (the formats of ../trace_events.h).
+
+ 	trace_decode [-f hz] [-t name1,name2,...] traceBuffer.bin
+
+ 	-f hz - Timestamp frequency (Timestamp_getFreq): print times in microseconds since the
+ 	        first record instead of raw Timestamp_get32() values;
+ 	-t    - names of Task IDs 1, 2, ... (the order the Tasks started in - see taskId).
+
+ The image has the MSP430 layout of TraceBuffer_T: a 32 bit head, then records of 10 bytes
+ (32 bit timestamp, 16 bit arg1 and arg2, 8 bit event and Task ID), all little endian. The
+ number of records is taken from the size of the file.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TRACE_HEAD_BYTES 4
+#define TRACE_RECORD_BYTES 10
+#define TRACE_MAX_TASKS 32
+
+static const char *const formats[] = {
+#define TRACE_EVENT(name, level, category, format) format,
+#include "../trace_events.h"
+#undef TRACE_EVENT
+};
+static const unsigned eventCount = sizeof(formats) / sizeof(formats[0]);
+
+static unsigned long le(const unsigned char *p, int bytes)
+{
+	unsigned long v = 0;
+
+	while(bytes-- > 0)
+		v = (v << 8) | p[bytes];
+	return v;
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: trace_decode [-f hz] [-t name1,name2,...] traceBuffer.bin\n");
+	exit(EXIT_FAILURE);
+}
+
+int main(int argc, char **argv)
+{
+	const char *names[TRACE_MAX_TASKS + 1] = { "-" };
+	double hz = 0;
+	unsigned char *image;
+	unsigned long head, size, count, first, i;
+	unsigned long t0 = 0;
+	long length;
+	FILE *f;
+	int opt;
+
+	while((opt = getopt(argc, argv, "f:t:")) != -1)
+	{
+		if(opt == 'f')
+			hz = atof(optarg);
+		else if(opt == 't')
+		{
+			char *name = strtok(optarg, ",");
+			for(i = 1; name != NULL && i <= TRACE_MAX_TASKS; i++, name = strtok(NULL, ","))
+				names[i] = name;
+		}
+		else
+			usage();
+	}
+	if(optind != argc - 1)
+		usage();
+
+	f = fopen(argv[optind], "rb");
+	if(f == NULL || fseek(f, 0, SEEK_END) != 0 || (length = ftell(f)) < 0)
+	{
+		perror(argv[optind]);
+		return EXIT_FAILURE;
+	}
+	rewind(f);
+	image = malloc(length + 1);
+	if(image == NULL || fread(image, 1, length, f) != (size_t)length)
+	{
+		perror(argv[optind]);
+		return EXIT_FAILURE;
+	}
+	fclose(f);
+	if(length < TRACE_HEAD_BYTES + TRACE_RECORD_BYTES)
+	{
+		fprintf(stderr, "%s: too short for a trace buffer\n", argv[optind]);
+		return EXIT_FAILURE;
+	}
+
+	head = le(image, 4);
+	size = (length - TRACE_HEAD_BYTES) / TRACE_RECORD_BYTES;
+	count = head < size ? head : size;
+	first = head - count;
+	printf("%lu events written, the last %lu kept\n", head, count);
+	for(i = 0; i < count; i++)
+	{
+		const unsigned char *r = image + TRACE_HEAD_BYTES + ((first + i) % size) * TRACE_RECORD_BYTES;
+		unsigned long timestamp = le(r, 4);
+		unsigned arg1 = le(r + 4, 2), arg2 = le(r + 6, 2), event = r[8], task = r[9];
+		char id[16];
+
+		if(i == 0)
+			t0 = timestamp;
+		if(hz > 0)
+			printf("[%12.1f us] ", (unsigned long)(timestamp - t0) % 0x100000000UL * 1e6 / hz);
+		else
+			printf("[%10lu] ", timestamp);
+		if(task <= TRACE_MAX_TASKS && names[task] != NULL)
+			printf("%-16s ", names[task]);
+		else
+		{
+			snprintf(id, sizeof(id), "task %u", task);
+			printf("%-16s ", id);
+		}
+		if(event < eventCount)
+			printf(formats[event], arg1, arg2);
+		else
+			printf("unknown event %u (%u, %u)", event, arg1, arg2);
+		putchar('\n');
+	}
+	free(image);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,14 @@
+/*
+ workload_trace_example.h
+
+ Example trace for WORKLOAD_TRACE (see main.c): { gap before the item in microseconds, item
+ value }. A burst of ten items 1ms apart, two quick pairs, then a quarter of a second of
+ silence - replayed in a loop by every producer.
+
+ 	make -B DEFS='-DWORKLOAD=4 -DWORKLOAD_TRACE_HEADER=\"host/workload_trace_example.h\"'
+ */
+#define WORKLOAD_TRACE_ENTRIES \
+	{ 1000, 3 }, { 1000, 1 }, { 1000, 4 }, { 1000, 1 }, { 1000, 5 }, \
+	{ 1000, 9 }, { 1000, 2 }, { 1000, 6 }, { 1000, 5 }, { 1000, 3 }, \
+	{ 20000, 5 }, { 0, 8 }, { 20000, 9 }, { 0, 7 }, \
+	{ 250000, 9 }
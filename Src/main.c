@@ -5,6 +5,7 @@
 #include <xdc/std.h>  						//mandatory - have to include first, for BIOS types
 #include <ti/sysbios/BIOS.h> 				//mandatory - if you call APIs like BIOS_start()
 #include <xdc/runtime/Log.h>				//needed for any Log_info() call
+#include <xdc/runtime/Timestamp.h>			//Timestamp_get32() - per-item latency
 #include <xdc/cfg/global.h> 				//header file for statically defined objects/handles
 
 
@@ -12,8 +13,6 @@
 // MSP430 Header Files
 //-----------------------------------------
 #include <driverlib.h>
-#include <stdlib.h> 						//for rand/strand
-#include <time.h>    						//for using the time as the seed to strand!
 
 //-----------------------------------------
 // MSP430 MCLK frequency settings
@@ -27,12 +26,545 @@
 					GPIO_PIN4|GPIO_PIN5|GPIO_PIN6|GPIO_PIN7
 
 
-#define BUFFER_SIZE 10 						//Size of the shared buffer
+#ifndef BUFFER_SIZE
+#define BUFFER_SIZE 10 						//Size of the shared buffer (a power of two avoids divisions)
+#endif
 #define MAX_VAL_NUM 10 						//Maximum value of randomly generated produced item!
 #define MIN_VAL_NUM 1 						//Minimum value of randomly generated produced item
+#define VAL_RANGE (MAX_VAL_NUM - MIN_VAL_NUM + 1)	//Number of possible produced item values
+
+// With RNG_SEED 0 the seeds come from RNG_ENTROPY(). On the target that is hardware noise:
+// rngEntropyInit, called by main, keeps the two lowest bits of 32 ADC12 conversions of the
+// temperature sensor (rngBootEntropy), which differ from reset to reset - unlike
+// Timestamp_get32() when a Task starts, a cycle count since reset which it is mixed with. The
+// host has no ADC: there it is the timestamp only (in pc_sim the same on every run).
+#ifndef RNG_SEED
+#define RNG_SEED 0							//0 - seed each producer from RNG_ENTROPY() and its ID; else a fixed seed
+#endif
+
+#ifndef RNG_ENTROPY
+#if defined(__TI_COMPILER_VERSION__)
+#define RNG_ENTROPY() (rngBootEntropy ^ Timestamp_get32())	//RNG_SEED 0: start value of a seed
+#else
+#define RNG_ENTROPY() Timestamp_get32()
+#endif
+#endif
+
+//-----------------------------------------
+// Producer workload model (build time, e.g. --define=WORKLOAD=2)
+// Decides WHEN a producer produces its next item (see workloadNext). Except for
+// WORKLOAD_SATURATE, producers sleep (Task_sleep) until the next arrival, which is scheduled
+// in microseconds and rounded to Clock ticks - several arrivals may fall in one tick.
+// WORKLOAD_RATES gives the mean rate (items/sec) of producer 1, 2, ...; producers past the
+// end of the list use its last entry.
+//-----------------------------------------
+#define WORKLOAD_SATURATE 0					//as fast as insert_item allows
+#define WORKLOAD_CONSTANT 1					//one item every 1/rate seconds
+#define WORKLOAD_POISSON 2					//exponentially distributed gaps with mean 1/rate
+#define WORKLOAD_BURSTY 3					//constant rate for WORKLOAD_ON_MS, then silent for WORKLOAD_OFF_MS
+#define WORKLOAD_TRACE 4					//replay (gap, value) pairs from WORKLOAD_TRACE_HEADER, in a loop
+
+#ifndef WORKLOAD
+#define WORKLOAD WORKLOAD_SATURATE
+#endif
+
+#ifndef WORKLOAD_RATES
+#define WORKLOAD_RATES 200, 100				//items/sec of producer 1, 2, ...
+#endif
+
+#ifndef WORKLOAD_ON_MS
+#define WORKLOAD_ON_MS 100					//WORKLOAD_BURSTY: length of a burst
+#endif
+
+#ifndef WORKLOAD_OFF_MS
+#define WORKLOAD_OFF_MS 400					//WORKLOAD_BURSTY: silence between bursts
+#endif
+
+// WORKLOAD_TRACE: WORKLOAD_TRACE_HEADER (e.g. --define=WORKLOAD_TRACE_HEADER="trace.h") defines
+// WORKLOAD_TRACE_ENTRIES, a list of { gap in microseconds, item value } initialisers, e.g.
+//		#define WORKLOAD_TRACE_ENTRIES { 1500, 3 }, { 0, 7 }, { 250000, 1 }
+#if WORKLOAD == WORKLOAD_TRACE
+#ifndef WORKLOAD_TRACE_HEADER
+#error "WORKLOAD_TRACE needs --define=WORKLOAD_TRACE_HEADER=<header defining WORKLOAD_TRACE_ENTRIES>"
+#endif
+#include WORKLOAD_TRACE_HEADER
+#endif
+
+//-----------------------------------------
+// Consumer service-time model (build time, e.g. --define=SERVICE=2)
+// How long a consumer is busy with each item it removed (see serviceItem), before it goes
+// back to remove_item. The consumer is modelled as waiting on an external resource: it
+// sleeps (Task_sleep) rather than spins, so other Tasks keep the CPU. Service times are
+// accumulated in microseconds and slept in whole Clock ticks, so short ones average out.
+// SERVICE_TIMES_US gives the mean service time of consumer 1, 2, ...; consumers past the
+// end of the list use its last entry.
+//-----------------------------------------
+#define SERVICE_NONE 0						//no service time - consume as fast as fullSlots allows
+#define SERVICE_FIXED 1						//every item takes the mean time
+#define SERVICE_EXPONENTIAL 2				//exponentially distributed around the mean
+#define SERVICE_PROPORTIONAL 3				//item value * mean / average item value (as blinksNum)
+#define SERVICE_HEAVY_TAIL 4				//Pareto distributed with the given mean (shape SERVICE_PARETO_SHAPE_X10/10)
+
+#ifndef SERVICE
+#define SERVICE SERVICE_NONE
+#endif
+
+#ifndef SERVICE_TIMES_US
+#define SERVICE_TIMES_US 5000, 5000			//mean service time of consumer 1, 2, ... (microseconds)
+#endif
+
+#ifndef SERVICE_PARETO_SHAPE_X10
+#define SERVICE_PARETO_SHAPE_X10 15			//SERVICE_HEAVY_TAIL: shape 1.5 - finite mean, infinite variance
+#endif
 #define RED GPIO_PORT_P1, GPIO_PIN0 		//Red LED
 #define GREEN GPIO_PORT_P4, GPIO_PIN7 		//Green LED
-#define EMPTY_SLOT_IND -1					//Indicator for an empty buffer slot
+
+#ifndef BUFFER_CHECKED
+#define BUFFER_CHECKED 1					//1 - track slot occupancy and report overwrite/underflow
+#endif
+
+//-----------------------------------------
+// Buffer capacity arithmetic
+// MSP430 has no hardware divider, so "%" is a library call. Indices are advanced with a mask
+// when BUFFER_SIZE is a power of two, and with a compare-and-wrap otherwise.
+//-----------------------------------------
+#define BUFFER_SIZE_IS_POW2 ((BUFFER_SIZE & (BUFFER_SIZE - 1)) == 0)
+#if BUFFER_SIZE_IS_POW2
+#define BUFFER_NEXT(i) (((i) + 1) & (BUFFER_SIZE - 1))
+#else
+#define BUFFER_NEXT(i) ((i) + 1 == BUFFER_SIZE ? 0 : (i) + 1)
+#endif
+
+//-----------------------------------------
+// Buffer item (payload) type
+// By default an item is a plain Int value (MIN_VAL_NUM..MAX_VAL_NUM). To carry a structured
+// payload, build with --define=BUFFER_ITEM_HEADER="my_item.h", where my_item.h defines:
+//
+//	BUFFER_ITEM_T		 - the payload type (e.g. a struct);
+//	ITEM_MAKE(v)		 - an expression of type BUFFER_ITEM_T for the produced value v;
+//	ITEM_VALUE(item)	 - the Int value of an item (logged and blinked by the LED service).
+//
+// Every value of the payload type is a valid item: whether a slot is empty is not kept in the
+// slot itself (see slotFull).
+//-----------------------------------------
+#ifdef BUFFER_ITEM_HEADER
+#include BUFFER_ITEM_HEADER
+#else
+#define BUFFER_ITEM_T Int
+#define ITEM_MAKE(v) (v)
+#define ITEM_VALUE(item) (item)
+#endif
+
+//-----------------------------------------
+// Slot occupancy checks
+// With BUFFER_CHECKED, slotFull[] shadows the buffer and insert_item/remove_item report an
+// attempt to overwrite a full slot or to consume an empty one. Without it the checks compile
+// away, and a produce/consume is exactly one store/load of the buffer.
+//-----------------------------------------
+#if BUFFER_CHECKED
+#define SLOT_IS_FULL(i) (slotFull[i])
+#define SLOT_IS_EMPTY(i) (!slotFull[i])
+#define SLOT_SET_FULL(i) (slotFull[i] = TRUE)
+#define SLOT_SET_EMPTY(i) (slotFull[i] = FALSE)
+#else
+#define SLOT_IS_FULL(i) FALSE
+#define SLOT_IS_EMPTY(i) FALSE
+#define SLOT_SET_FULL(i)
+#define SLOT_SET_EMPTY(i)
+#endif
+
+//-----------------------------------------
+// Per-item latency (insert_item to remove_item)
+// With LATENCY_STATS, insert_item stamps the slot with Timestamp_get32() and remove_item adds
+// the time the item spent in the buffer to a log2 histogram (latencyHist): each power of two
+// is split into LATENCY_SUB_BUCKETS buckets, so the memory is fixed and every bucket is at
+// most 1/LATENCY_SUB_BUCKETS of its values wide. Off by default on the target: latencyHist
+// and slotStamp take about 0.5 KB of the MSP430's RAM (see host/mem_budget.sh).
+//-----------------------------------------
+#ifndef LATENCY_STATS
+#if defined(__TI_COMPILER_VERSION__)
+#define LATENCY_STATS 0						//target: --define=LATENCY_STATS=1 for the histogram
+#else
+#define LATENCY_STATS 1
+#endif
+#endif
+
+#ifndef LATENCY_SUB_BITS
+#define LATENCY_SUB_BITS 2					//2 - 4 buckets per power of two (25% resolution)
+#endif
+
+#ifndef LATENCY_DUMP_EVERY
+#define LATENCY_DUMP_EVERY 0				//consumerTask1 logs the percentiles every N items (0 - never)
+#endif
+
+#ifndef STACK_DUMP_EVERY
+#define STACK_DUMP_EVERY 0					//consumerTask1 logs the stack high-water marks every N removals (0 - never)
+#endif
+
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BITS)
+#define LATENCY_BUCKETS ((33 - LATENCY_SUB_BITS) * LATENCY_SUB_BUCKETS)	//covers all 32 bit values
+
+#if LATENCY_STATS
+#define SLOT_STAMP(i) (slotStamp[i] = Timestamp_get32())
+#define SLOT_LATENCY(i) latencyRecord(Timestamp_get32() - slotStamp[i])
+#else
+#define SLOT_STAMP(i)
+#define SLOT_LATENCY(i)
+#endif
+
+//-----------------------------------------
+// Semaphore wait profiler
+// With SEM_PROFILE, the Semaphore_pend/Semaphore_post calls of the Tasks go through
+// SEM_PEND/SEM_POST, which count acquisitions, blocked acquisitions, failed pends, posts and
+// the time spent blocked, per semaphore and per Task (semProfile) - telling whether producers
+// and consumers wait for buffer capacity (emptySlots/fullSlots) or for the lock (mutex).
+// A Task's semProfile row is its statsRows row (see taskId).
+//-----------------------------------------
+#ifndef SEM_PROFILE
+#define SEM_PROFILE 0
+#endif
+
+#define SEM_PROFILE_SEMS 6					//emptySlots, fullSlots, mutex, setLedEnvMutex, ledSrvSchedSem, ledBlinkDoneSem
+
+#if SEM_PROFILE
+#define SEM_PEND(sem, timeout) semProfiledPend((sem), (timeout))
+#define SEM_POST_BIOS(sem) semProfiledPost(sem)
+#else
+#define SEM_PEND(sem, timeout) Semaphore_pend((sem), (timeout))
+#define SEM_POST_BIOS(sem) Semaphore_post(sem)
+#endif
+
+//-----------------------------------------
+// Per-Task counters
+// Every producerTask/consumerTask/ledSrvTask counts its own work (items produced/consumed,
+// insert/remove errors, LED requests posted/served) in a row of statsRows which only it
+// writes, so the hot path takes no lock. statsSnapshot reads all rows at any time, without
+// taking "mutex" (see StatsRow_T). The row number is also the Task's ID in semProfile and in
+// the trace ring. A Task beyond STATS_TASKS is left out of every total, so the table must hold
+// all of them: empty.cfg has 5, and the host Makefile raises it for up to 16x16 runs (the host
+// report refuses to print totals which leave Tasks out). Every row also costs a TimeSlice_T
+// (and with SEM_PROFILE a semProfile row), so keep it at the Tasks the configuration has.
+//-----------------------------------------
+#ifndef STATS_TASKS
+#define STATS_TASKS 5						//Tasks with a row in statsRows (further Tasks are not counted)
+#endif
+
+//-----------------------------------------
+// Time slicing (see tsClockHandler)
+// timeSharingClk expires on every Clock tick (500 us). TIME_SLICE_FIXED yields the running
+// Task on every tick. TIME_SLICE_ADAPTIVE gives the running Task a quantum of
+// TIME_SLICE_QUANTUM ticks and yields only once it is used up AND another Task of the same
+// priority is ready: a yield with no such Task, or one just before the Task blocks on a
+// Semaphore anyway, only costs a trip through the scheduler. The ticks every Task ran and the
+// yields forced on it or saved are counted per Task (timeSliceSnapshot). Fewer forced switches
+// also mean longer runs of one side, so the buffer runs fuller and items wait longer in it:
+// TIME_SLICE_FIXED when item latency matters more than throughput.
+//-----------------------------------------
+#define TIME_SLICE_FIXED 0
+#define TIME_SLICE_ADAPTIVE 1
+
+#ifndef TIME_SLICE
+#define TIME_SLICE TIME_SLICE_ADAPTIVE		//Time slicing policy of tsClockHandler
+#endif
+
+#ifndef TIME_SLICE_QUANTUM
+#define TIME_SLICE_QUANTUM 2				//Clock ticks a Task runs before it yields to a ready peer
+#endif
+
+//-----------------------------------------
+// Tickless idle (build with the empty.cfg "tickless" configuration argument)
+// With Clock.tickMode = TickMode_DYNAMIC the Clock timer only interrupts for the next Clock
+// object due, and the idle Task sleeps in LPM3 until then (or until a GPIO interrupt) - but
+// timeSharingClk, due every tick, would still wake it every 500 us. With TICKLESS,
+// tsClockHandler stops timeSharingClk when it finds the idle Task running or no other Task
+// ready at the running one's priority, and every SEM_POST - which may ready a second Task of
+// that priority - starts it again (timeSliceWake). A Task woken from Task_sleep is sliced from
+// the next post on (producers and consumers post every item). Requires TIME_SLICE_ADAPTIVE.
+//-----------------------------------------
+#ifndef TICKLESS
+#define TICKLESS 0							//1 - stop timeSharingClk while no time slicing is needed
+#endif
+
+#if TICKLESS && TIME_SLICE != TIME_SLICE_ADAPTIVE
+#error TICKLESS needs TIME_SLICE_ADAPTIVE
+#endif
+
+#if TICKLESS
+#define SEM_POST(sem) do { SEM_POST_BIOS(sem); timeSliceWake(); } while(0)
+#else
+#define SEM_POST(sem) SEM_POST_BIOS(sem)
+#endif
+
+//-----------------------------------------
+// Event trace (see traceEvent and trace_events.h)
+// Produce/consume/error events used to be formatted Log_info calls. With TRACE_SINK_RING
+// they are binary records (event, Task ID, Timestamp_get32(), two arguments) written to
+// traceBuffer - a flight recorder which keeps the latest TRACE_RING_SIZE events. Halt the
+// target, save traceBuffer from the memory browser as a binary file and render it with the
+// host decoder (host/trace_decode.c) back into the Log messages. The ring takes
+// TRACE_RING_SIZE * 10 + 4 bytes of RAM, so the target build keeps the Log_info calls by
+// default (the UIA loggers of the "debug" profile are there anyway) and the host uses the ring.
+//-----------------------------------------
+#define TRACE_SINK_LOG 0					//every event is a Log_info call, as before
+#define TRACE_SINK_RING 1					//every event is a record in traceBuffer
+#define TRACE_SINK_NONE 2					//events are compiled out
+
+#ifndef TRACE_SINK
+#if defined(__TI_COMPILER_VERSION__)
+#define TRACE_SINK TRACE_SINK_LOG			//target: --define=TRACE_SINK=1 for the flight recorder
+#else
+#define TRACE_SINK TRACE_SINK_RING
+#endif
+#endif
+
+#ifndef TRACE_RING_SIZE
+#define TRACE_RING_SIZE 64					//records in traceBuffer (a power of two; 10 bytes each on MSP430)
+#endif
+
+#if TRACE_SINK == TRACE_SINK_RING && (TRACE_RING_SIZE & (TRACE_RING_SIZE - 1)) != 0
+#error "TRACE_RING_SIZE must be a power of two"
+#endif
+
+// Every event has a level and a category (trace_events.h), and is raised with the macro of
+// its level: TRACE_DEBUG, TRACE_INFO or TRACE_ERROR(name, arg1, arg2). The macros of the
+// levels below TRACE_LEVEL are ((void)0) - the site, its arguments included, disappears in
+// the preprocessor, at any optimisation level - so a release build (--define=TRACE_LEVEL=2)
+// carries the error events only. A macro used for an event of another level does not
+// compile. Of the rest, the categories not set in traceMask (TRACE_MASK at start-up, then
+// traceSetMask) are skipped at run time.
+#define TRACE_LEVEL_DEBUG 0					//per-item data path events
+#define TRACE_LEVEL_INFO 1					//occasional events worth knowing about
+#define TRACE_LEVEL_ERROR 2					//abnormal behaviour
+
+#define TRACE_CATEGORY_DATA 0x1				//the shared buffer: produce/consume
+#define TRACE_CATEGORY_LED 0x2				//the LED service
+#define TRACE_CATEGORY_SYS 0x4				//configuration and start-up
+
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL TRACE_LEVEL_DEBUG
+#endif
+
+#ifndef TRACE_MASK
+#define TRACE_MASK (TRACE_CATEGORY_DATA | TRACE_CATEGORY_LED | TRACE_CATEGORY_SYS)
+#endif
+
+//The event's names are pasted by the TRACE_<level> macros themselves: an event such as
+//BACKPRESSURE_OFF is a macro too, which would be expanded if passed on as it is.
+#define TRACE_AT(level, levelOf, categoryOf, event, arg1, arg2) \
+	do { \
+		(void)sizeof(char[(levelOf) == (level) ? 1 : -1]); \
+		if((traceMask & (categoryOf)) != 0) \
+			traceEvent((event), (arg1), (arg2)); \
+	} while(0)
+
+#if TRACE_LEVEL <= TRACE_LEVEL_DEBUG
+#define TRACE_DEBUG(name, arg1, arg2) \
+	TRACE_AT(TRACE_LEVEL_DEBUG, TRACE_LEVEL_OF_##name, TRACE_CATEGORY_OF_##name, TRACE_##name, arg1, arg2)
+#else
+#define TRACE_DEBUG(name, arg1, arg2) ((void)0)
+#endif
+
+#if TRACE_LEVEL <= TRACE_LEVEL_INFO
+#define TRACE_INFO(name, arg1, arg2) \
+	TRACE_AT(TRACE_LEVEL_INFO, TRACE_LEVEL_OF_##name, TRACE_CATEGORY_OF_##name, TRACE_##name, arg1, arg2)
+#else
+#define TRACE_INFO(name, arg1, arg2) ((void)0)
+#endif
+
+#if TRACE_LEVEL <= TRACE_LEVEL_ERROR
+#define TRACE_ERROR(name, arg1, arg2) \
+	TRACE_AT(TRACE_LEVEL_ERROR, TRACE_LEVEL_OF_##name, TRACE_CATEGORY_OF_##name, TRACE_##name, arg1, arg2)
+#else
+#define TRACE_ERROR(name, arg1, arg2) ((void)0)
+#endif
+
+//-----------------------------------------
+// Buffer engine selection (build time, e.g. --define=BUFFER_ENGINE=1)
+//-----------------------------------------
+#define BUFFER_ENGINE_SEMAPHORE 0			//emptySlots/mutex/fullSlots protocol (lecture notes)
+#define BUFFER_ENGINE_SPSC 1				//wait-free ring - ONE producerTask and ONE consumerTask only!
+#define BUFFER_ENGINE_MPMC 2				//bounded queue with per-slot sequence numbers (no mutex)
+
+#ifndef BUFFER_ENGINE
+#define BUFFER_ENGINE BUFFER_ENGINE_SEMAPHORE
+#endif
+
+#ifndef PRODUCER_BATCH_SIZE
+#define PRODUCER_BATCH_SIZE 1				//items generated and inserted per producer loop iteration
+#endif
+
+#ifndef CONSUMER_BATCH_SIZE
+#define CONSUMER_BATCH_SIZE 1				//maximum items removed per consumer loop iteration
+#endif
+
+#ifndef LED_SERVICE
+#define LED_SERVICE 1						//0 - producers/consumers do not post LED requests (benchmarking)
+#endif
+
+//-----------------------------------------
+// Backpressure (see backpressureUpdate)
+// Without it a producer only learns that the consumers fell behind by blocking on emptySlots,
+// with all the other producers queued up behind it. With BACKPRESSURE, every insert/remove
+// compares the buffer occupancy ("count", or in - out for the engines without it) with two
+// watermarks: reaching BACKPRESSURE_HIGH turns backpressure on and falling to BACKPRESSURE_LOW
+// turns it off again (the gap keeps it from flapping with every item). Every change calls the
+// function set with backpressureSetCallback; the producers themselves then go on as before
+// (BACKPRESSURE_NOTIFY), pause until it is off (BACKPRESSURE_THROTTLE) or drop the items they
+// generate meanwhile (BACKPRESSURE_SHED) - counted per Task in statsRows.
+//-----------------------------------------
+#define BACKPRESSURE_OFF 0					//no watermarks
+#define BACKPRESSURE_NOTIFY 1				//only the callback is called
+#define BACKPRESSURE_THROTTLE 2				//producers sleep BACKPRESSURE_THROTTLE_TICKS at a time while it is on
+#define BACKPRESSURE_SHED 3					//producers drop their new items (one per BACKPRESSURE_THROTTLE_TICKS) while it is on
+
+#ifndef BACKPRESSURE
+#define BACKPRESSURE BACKPRESSURE_OFF
+#endif
+
+#ifndef BACKPRESSURE_HIGH
+#define BACKPRESSURE_HIGH (BUFFER_SIZE * 3 / 4)	//items in the buffer which turn backpressure on
+#endif
+
+#ifndef BACKPRESSURE_LOW
+#define BACKPRESSURE_LOW (BUFFER_SIZE / 4)	//items in the buffer which turn it off again
+#endif
+
+#ifndef BACKPRESSURE_THROTTLE_TICKS
+#define BACKPRESSURE_THROTTLE_TICKS 1		//THROTTLE/SHED: Clock ticks between two looks at it
+#endif
+
+#if BACKPRESSURE != BACKPRESSURE_OFF && \
+	(BACKPRESSURE_LOW < 0 || BACKPRESSURE_LOW >= BACKPRESSURE_HIGH || BACKPRESSURE_HIGH > BUFFER_SIZE)
+#error "BACKPRESSURE needs 0 <= BACKPRESSURE_LOW < BACKPRESSURE_HIGH <= BUFFER_SIZE"
+#endif
+
+//-----------------------------------------
+// Consumer priority classes
+// All consumerTasks pend on fullSlots, and BIOS hands a post to the pending Task of the
+// highest priority (Semaphore.supportsPriority) - which makes no difference while they share
+// one priority. consumerHandler sets the priority of consumer 1, 2, ... to its entry of
+// CONSUMER_PRIORITIES (the last entry repeats; 0 - as in empty.cfg). E.g. "2, 1" makes
+// consumerTask1 the primary consumer, which gets every item it is free to take, and
+// consumerTask2 a standby which only gets the items posted while consumerTask1 is busy
+// serving one: at light load it stays blocked, under overload both work. A consumer above the
+// producers' priority preempts them as soon as an item is posted (more Task switches), and
+// none should reach ledSrvTask's priority (3). Not with BUFFER_ENGINE_MPMC: its consumers
+// Task_yield while a position's item is still being produced, which never lets a producer of
+// a lower priority finish it.
+//-----------------------------------------
+#if defined(CONSUMER_PRIORITIES) && BUFFER_ENGINE == BUFFER_ENGINE_MPMC
+#error "CONSUMER_PRIORITIES cannot be used with BUFFER_ENGINE_MPMC"
+#endif
+
+#ifndef CONSUMER_PRIORITIES
+#define CONSUMER_PRIORITIES 0				//priority of consumer 1, 2, ... (0 - as set in empty.cfg)
+#endif
+
+//-----------------------------------------
+// Insert/remove deadlines (see insert_item_timeout/remove_item_timeout)
+// By default a producer/consumer waits as long as it takes for a free slot/an item. With a
+// timeout, it gives up after that many Clock ticks: the producer drops its item, the consumer
+// tries again. Each give-up is a timeout, and each call that did succeed but only past its
+// deadline (e.g. preempted after its wait) a deadline miss - both counted per Task in
+// statsRows. Single item calls only (PRODUCER_BATCH_SIZE/CONSUMER_BATCH_SIZE of 1).
+//-----------------------------------------
+#ifndef INSERT_TIMEOUT_TICKS
+#define INSERT_TIMEOUT_TICKS 0				//Clock ticks a producer waits for a free slot (0 - forever)
+#endif
+
+#ifndef REMOVE_TIMEOUT_TICKS
+#define REMOVE_TIMEOUT_TICKS 0				//Clock ticks a consumer waits for an item (0 - forever)
+#endif
+
+#if (INSERT_TIMEOUT_TICKS > 0 && PRODUCER_BATCH_SIZE > 1) || (REMOVE_TIMEOUT_TICKS > 0 && CONSUMER_BATCH_SIZE > 1)
+#error "INSERT_TIMEOUT_TICKS/REMOVE_TIMEOUT_TICKS need single item producers/consumers"
+#endif
+
+//-----------------------------------------
+// LED request queue (between producers/consumers and ledSrvTask)
+//-----------------------------------------
+#define LED_POLICY_DROP_NEWEST 0			//full queue: the new request is dropped
+#define LED_POLICY_DROP_OLDEST 1			//full queue: the oldest queued request is dropped
+#define LED_POLICY_COALESCE 2				//a request is merged into the queued request for the same LED
+
+#define LED_COALESCE_SUM 0					//merged request blinks the sum of both blinksNum
+#define LED_COALESCE_LATEST 1				//merged request blinks the latest blinksNum
+
+#ifndef LED_QUEUE_SIZE
+#define LED_QUEUE_SIZE 8					//Number of LED requests which may wait for ledSrvTask
+#endif
+
+#ifndef LED_QUEUE_POLICY
+#define LED_QUEUE_POLICY LED_POLICY_COALESCE
+#endif
+
+#ifndef LED_COALESCE_MODE
+#define LED_COALESCE_MODE LED_COALESCE_SUM
+#endif
+
+#ifndef LED_MAX_BLINKS
+#define LED_MAX_BLINKS 20					//Coalesced requests never ask for more blinks than this
+#endif
+
+#ifndef LED_TOGGLE_TICKS
+#define LED_TOGGLE_TICKS 256				//Clock ticks between LED toggles (128ms - the old 1024000 cycles delay at 8MHz)
+#endif
+
+#ifndef LED_MAX_BLINK_RATE
+#define LED_MAX_BLINK_RATE 0				//Max blinks per second (0 - use LED_TOGGLE_TICKS); see ledSetMaxBlinkRate
+#endif
+
+//-----------------------------------------
+// Atomic access helpers (used by the lock-free buffer engines)
+//-----------------------------------------
+#if defined(__TI_COMPILER_VERSION__)
+// MSP430 is a single core and 16 bit accesses are atomic: volatile accesses are never reordered
+// with each other by the compiler, so plain volatile loads/stores already have the required
+// ordering. Only read-modify-write operations have to be protected against preemption.
+#include <ti/sysbios/hal/Hwi.h>
+#define ATOMIC_LOAD_RLX(p)		(*(p))
+#define ATOMIC_LOAD_ACQ(p)		(*(p))
+#define ATOMIC_STORE_RLX(p, v)	(*(p) = (v))
+#define ATOMIC_STORE_REL(p, v)	(*(p) = (v))
+#define ATOMIC_FENCE()
+#else
+// Host build (GCC/Clang) - real multi-core, so use the compiler's atomic builtins
+#define ATOMIC_LOAD_RLX(p)		__atomic_load_n((p), __ATOMIC_RELAXED)
+#define ATOMIC_LOAD_ACQ(p)		__atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define ATOMIC_STORE_RLX(p, v)	__atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define ATOMIC_STORE_REL(p, v)	__atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define ATOMIC_FENCE()			__atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
+
+#if BUFFER_ENGINE == BUFFER_ENGINE_SPSC
+// "in"/"out" run over 0..2*BUFFER_SIZE-1, so a full ring (distance BUFFER_SIZE) can be told
+// apart from an empty one (distance 0) without a shared "count"
+#define SPSC_WRAP (2 * BUFFER_SIZE)
+#if BUFFER_SIZE_IS_POW2
+#define SPSC_NEXT(i) (((i) + 1) & (SPSC_WRAP - 1))
+#define SPSC_SLOT(i) ((i) & (BUFFER_SIZE - 1))
+#define SPSC_USED(head, tail) (((head) - (tail)) & (SPSC_WRAP - 1))
+#else
+#define SPSC_NEXT(i) ((i) + 1 == SPSC_WRAP ? 0 : (i) + 1)
+#define SPSC_SLOT(i) ((i) < BUFFER_SIZE ? (i) : (i) - BUFFER_SIZE)
+#define SPSC_USED(head, tail) ((head) >= (tail) ? (head) - (tail) : (head) - (tail) + SPSC_WRAP)
+#endif
+#endif
+
+#if BUFFER_ENGINE == BUFFER_ENGINE_MPMC
+// Positions run over 0..MPMC_WRAP-1. MPMC_WRAP is a multiple of BUFFER_SIZE (so a position
+// always maps to the same slot) and fits a 16 bit Int; MPMC_DIFF is the signed distance
+// between two positions modulo MPMC_WRAP.
+#define MPMC_WRAP (BUFFER_SIZE * (0x4000 / BUFFER_SIZE))
+#define MPMC_ADD(p, n) ((p) + (n) >= MPMC_WRAP ? (p) + (n) - MPMC_WRAP : (p) + (n))
+#define MPMC_DIFF(a, b) ((a) - (b) > MPMC_WRAP / 2 ? (a) - (b) - MPMC_WRAP : \
+						 (a) - (b) < -(MPMC_WRAP / 2) ? (a) - (b) + MPMC_WRAP : (a) - (b))
+#if BUFFER_SIZE_IS_POW2
+#define MPMC_SLOT(p) ((p) & (BUFFER_SIZE - 1))
+#else
+#define MPMC_SLOT(p) ((p) % BUFFER_SIZE)
+#endif
+#endif
 
 //-----------------------------------------
 // Prototypes
@@ -53,19 +585,21 @@ typedef enum
  This Structure is used, in order to communicate between the producerTask/consumerTask and
  the ledSrvTask (which provides LED blinking services) - each one of the
  producerTask/consumerTask fills it with the appropriate LED blinking specification
- (after producing/consuming an item) and "send" it to ledSrvTask. Well, it is not really a
- "sending" operation, but using the ability BIOS is providing us to set/get the Env (Environment)
- of a Task, using Task_setEnv and Task_getEnv API functions (see API Documentation) - recall,
- setting the Task Env is merely giving it a generic pointer (of type Ptr - which is simply a
- void * pointer - hence generic, which could be a pointer to anything!) to some data. The Task
- whose Env was set can then get this Env data pointer using Task_getEnv API function (and cast
- the pointer appropriately!) and then read the data!
-
- In this case, producerTask/consumerTask fills a local copy of this structure with the
- appropriate LED blinking specification (after producing/consuming an item) and then sending
- the pointer to this structure to ledSrvTask using Task_setEnv API function.
- Then, when ledSrvTask gets to run, it simply reads this Env pointer using Task_getEnv API
- function (casting the result, of course, to type LedBlinksInfo_T *).
+ (after producing/consuming an item) and "send" it to ledSrvTask.
+
+ The "sending" is done by prepForLedSrv, which COPIES the structure into the LED request queue
+ (ledQueue - a cyclic buffer of LED_QUEUE_SIZE requests) and releases ledSrvTask. Since the
+ request is copied by value, the sender may reuse its local structure right away and does not
+ have to wait for ledSrvTask to read it - several requests can be in flight at the same time.
+ When ledSrvTask gets to run, it takes the requests out of the queue, one by one (ledQueueGet).
+
+ LED_QUEUE_POLICY decides how the queue copes with ledSrvTask falling behind (and it always
+ does - producers/consumers run far faster than a human can follow blinks):
+ LED_POLICY_COALESCE (the default) keeps at most one request per LED in the queue - a new
+ request for an LED which already has a queued request is merged into it (LED_COALESCE_MODE:
+ the blinks are summed, up to LED_MAX_BLINKS, or the latest blinksNum wins). The other
+ policies queue every request and, once the queue is full, drop the new request
+ (LED_POLICY_DROP_NEWEST) or the oldest queued one (LED_POLICY_DROP_OLDEST).
  The LED blinking specification is simple:
 
  	 - producerTask fills the "led" field to be green_e whereas consumerTask fills
@@ -81,12 +615,16 @@ typedef struct
 }LedBlinksInfo_T;
 
 
+//BufferItem_T - type of the items held in the shared buffer (see BUFFER_ITEM_T above)
+typedef BUFFER_ITEM_T BufferItem_T;
+
+
 //The usual hardware_init function
 void hardware_init(void);
 
 
 /*
- Function: Bool insert_item(Int item)
+ Function: Bool insert_item(BufferItem_T item)
 
  This function is called from the producerTask (after producerTask generated a random number
  in the value between 1 and MAX_VAL_NUM). This function receives the produced item in the
@@ -104,10 +642,11 @@ void hardware_init(void);
     are updated accordingly!). Otherwise, if there is something wrong (i.e. Abnormal Behaviour)
     - it should issue a Log message and return FALSE.
     Abnormal behaviour (Unsuccessful Result), in this case, would be to try and write the item
-    on an existing (not consumed!) data-item in the buffer (i.e. buffer[in] value is NOT -1:
-    recall - an "empty" buffer cell is always marked with -1 - this is done in initialisation
-    of the "buffer" (in main function) and also by the consumer's function remove_item, which
-    sets the consumed cell value to -1, after consumption is done!).
+    on an existing (not consumed!) data-item in the buffer (i.e. slot "in" is marked full:
+    recall - the occupancy of each buffer cell is kept in slotFull - all cells are marked
+    empty in initialisation (in main function), insert_item marks the cell it fills as full
+    and the consumer's function remove_item marks the consumed cell as empty again!).
+    These checks are only compiled in BUFFER_CHECKED builds.
 
     The shared data in this case are the global variables defined in the global section: the
     shared "buffer" array, the "in" variable - managing the next empty slot in the
@@ -117,7 +656,7 @@ void hardware_init(void);
     After gaining access to the shared data (according to the Algorithm in the lecture notes),
     insert_item function should perform the following:
 
-    1) Check if  Abnormal behaviour (i.e. buffer[in] value is NOT -1). If Abnormal behaviour
+    1) Check if  Abnormal behaviour (i.e. slot "in" is marked full). If Abnormal behaviour
        is encountered, issue a Log message, release all the "taken" semaphores and return FALSE.
 
     2) If Everything is OK:
@@ -132,11 +671,11 @@ void hardware_init(void);
     3) Then, release the Semaphores (according to the Algorithm in the lecture notes) and
        return TRUE.
  */
-Bool insert_item(Int item);
+Bool insert_item(BufferItem_T item);
 
 
 /*
- Function: Bool remove_item(Int *item);
+ Function: Bool remove_item(BufferItem_T *item);
 
  This function is called from the consumerTask. This function receives an address of a locally
  defined variable in a certain consumerTask and "consumes" the next available item
@@ -159,10 +698,11 @@ Bool insert_item(Int item);
     variables are updated accordingly!). Otherwise, if there is something wrong
     (i.e. Abnormal Behaviour) - it should issue a Log message and return FALSE.
     Abnormal behaviour (Unsuccessful Result), in this case, would be to try and remove a
-    non-existing item from the shared buffer (i.e. buffer[out] value is -1:
-    recall - an "empty" buffer cell is always marked with -1 - this is done in initialisation
-    of the "buffer" (in main function) and also by this function, which sets the consumed cell
-    value to -1, after consumption is done!).
+    non-existing item from the shared buffer (i.e. slot "out" is marked empty:
+    recall - the occupancy of each buffer cell is kept in slotFull - all cells are marked
+    empty in initialisation (in main function) and this function marks the consumed cell as
+    empty again, after consumption is done!). These checks are only compiled in BUFFER_CHECKED
+    builds.
 
     The shared data in this case are the global variables defined in the global section: the
     shared "buffer" array, the "out" variable - managing the next full slot in the shared buffer
@@ -171,13 +711,13 @@ Bool insert_item(Int item);
     After gaining access to the shared data (according to the Algorithm in the lecture notes),
     remove_item function should perform the following:
 
-    1) Check if  Abnormal behaviour (i.e. buffer[out] value is -1). If Abnormal behaviour
+    1) Check if  Abnormal behaviour (i.e. slot "out" is marked empty). If Abnormal behaviour
        is encountered, issue a Log message, release all the "taken" semaphores and return FALSE.
 
     2) If Everything is OK:
        - update the "count" global variable;
        - copy the value from the buffer at location "out" to *item;
-	   - mark the consumed cell in the shared buffer as empty (i.e. put there -1);
+	   - mark the consumed cell in the shared buffer as empty (in slotFull);
        - then update "out" global variable to hold the position of the next item for "consumption"
          (recall - buffer is cyclic! Look in the Lab document for further explanation on how to
          do that!);
@@ -188,7 +728,71 @@ Bool insert_item(Int item);
     3) Then, release the Semaphores (according to the Algorithm in the lecture notes) and
        return TRUE.
  */
-Bool remove_item(Int *item);
+Bool remove_item(BufferItem_T *item);
+
+
+/*
+ Functions: Int insert_items(const BufferItem_T *items, Int n) / Int remove_items(BufferItem_T *items, Int max)
+
+ Batch versions of insert_item/remove_item, for bursty producers/consumers. They follow the
+ same algorithm and error checking, but pay the critical section cost (mutex, publish or
+ position claim) once per batch rather than once per item. The slot counting of the semaphore
+ and MPMC engines is NOT batched: every slot/item taken or given back is still one
+ Semaphore_pend/post (see pendUpTo/postN), and only the first of them may block:
+
+ 	- they block (like insert_item/remove_item) only until ONE slot/item is available, and
+ 	  then take as many more as are available right now, up to n/max (see pendUpTo);
+
+ 	- all the taken slots/items are then inserted/removed in one critical section (semaphore
+ 	  engine: one hold of mutex; SPSC engine: one publish; MPMC engine: one position claim).
+
+ They return the number of items actually inserted/removed - which may be less than n/max,
+ so the caller should loop for the rest. 0 means Abnormal behaviour was found at the first
+ slot (exactly where insert_item/remove_item would have returned FALSE).
+ */
+Int insert_items(const BufferItem_T *items, Int n);
+Int remove_items(BufferItem_T *items, Int max);
+
+
+//BufferStatus_E enum - the outcome of insert_item_timeout/remove_item_timeout
+typedef enum
+{
+	buffer_ok_e,
+	buffer_error_e,
+	buffer_timeout_e
+} BufferStatus_E;
+
+/*
+ Functions: BufferStatus_E insert_item_timeout(BufferItem_T item, UInt32 timeout) /
+ 			BufferStatus_E remove_item_timeout(BufferItem_T *item, UInt32 timeout)
+
+ insert_item/remove_item with a deadline: "timeout" Clock ticks from the call (BIOS_NO_WAIT -
+ only if a slot/item is available right away; BIOS_WAIT_FOREVER - no deadline, which is what
+ insert_item/remove_item use). They return buffer_ok_e where insert_item/remove_item return
+ TRUE and buffer_error_e on Abnormal behaviour; if the deadline passes first, they give back
+ whatever semaphore they already took and return buffer_timeout_e, leaving the buffer as it
+ was.
+
+ With a deadline, every call is accounted in the calling Task's statsRows row (see
+ deadlineAccount): a buffer_timeout_e as a timeout, and a buffer_ok_e returned after the
+ deadline - the Task got its slot/item in time, but was then held up, e.g. by the mutex or
+ by preemption - as a deadline miss.
+ */
+BufferStatus_E insert_item_timeout(BufferItem_T item, UInt32 timeout);
+BufferStatus_E remove_item_timeout(BufferItem_T *item, UInt32 timeout);
+
+/*
+ Functions: UInt32 deadlineStart(UInt32 timeout) / UInt32 deadlineLeft(UInt32 start, UInt32 timeout) /
+ 			BufferStatus_E deadlineAccount(BufferStatus_E status, UInt32 start, UInt32 timeout)
+
+ Deadline helpers of insert_item_timeout/remove_item_timeout. deadlineStart returns the Clock
+ tick of the call (Clock_getTicks - not read for BIOS_WAIT_FOREVER); deadlineLeft the timeout
+ left for the next pend (BIOS_NO_WAIT once the deadline has passed); deadlineAccount counts
+ "status" as a timeout or a deadline miss, if it is one, and returns it.
+ */
+UInt32 deadlineStart(UInt32 timeout);
+UInt32 deadlineLeft(UInt32 start, UInt32 timeout);
+BufferStatus_E deadlineAccount(BufferStatus_E status, UInt32 start, UInt32 timeout);
 
 
 /*
@@ -208,7 +812,8 @@ Bool remove_item(Int *item);
 
  Then the while(TRUE) loop. Every iteration in this loop should perform the following:
 
- 1) Generate a random number between 1 and MAX_VAL_NUM;
+ 1) Generate a random number between MIN_VAL_NUM and MAX_VAL_NUM (workloadNext, which also
+    paces the producer according to the WORKLOAD model - see workloadInit/workloadNext);
 
  2) Send this number to insert_item function call. Recall, insert_item is the function that
     implements the producer algorithm for 1 item (as defined in the lecture notes) in the
@@ -224,25 +829,15 @@ Bool remove_item(Int *item);
 
   	A. Issue a Log message outputting the producerID and the value of the item produced;
 
-  	B. Set the Env of ledSrvTask (using Task_setEnv API function) to send it the up-to-dated
-  	   data for the Led Blink (i.e. sending it a pointer to the local LedBlinksInfo_T structure
-  	   that you must also update it with the proper information before that!)
-
-  	C. Release ledSrvTask to work (by posting the Scheduling Constraint Semaphore
-  	   ledSrvSchedSem, which ledSrvTask pends on).
-
-  	Now, since ledSrvTask is the highest priority Task in the system, it will immediately get
-  	to run and blink the appropriate Led (according to the specification you updated in
-  	LedBlinksInfo_T structure and sent it to ledSrvTask's Env).
+  	B. Update the local LedBlinksInfo_T structure with the data for the Led Blink and hand it
+  	   to prepForLedSrv, which copies it into the LED request queue and releases ledSrvTask to
+  	   work (by posting the Scheduling Constraint Semaphore ledSrvSchedSem, which ledSrvTask
+  	   pends on). prepForLedSrv returns right away - the blinking itself is done later, by
+  	   ledSrvTask, according to the copy in the queue.
 
-  	However, what happens if current Task yielded (by timeSharingClk), just after setting the
-  	ledSrvTask's Env, but before posting ledSrvSchedSem (i.e. before releasing ledSrvTask)???
-  	Some other producerTask/consumerTask may set ledSrvTask's Env with their data -
-  	running over the data set by current Task...!!! Reminds you of something???
-  	Indeed, this is RACE CONDITION!!!
-
-  	This means that the ENTIRE CODE in sections B & C above is a CRITICAL SECTION!!!! It must,
-  	therefore, be protected by a Mutex Semaphore (we named this Mutex Semaphore: setLedEnvMutex).
+  	The queue is shared by all producerTasks/consumerTasks and by ledSrvTask, so adding a
+  	request to it is a CRITICAL SECTION - it is protected by the Mutex Semaphore
+  	setLedEnvMutex (see prepForLedSrv). It is a short one, though: only the copy of the request.
 
   4) Go back to the beginning of the while(TRUE) loop;
  */
@@ -278,27 +873,18 @@ void producerHandler(UArg arg0, UArg arg1);
 
  3) If no abnormal behaviour:
 
-  	A. Issue a Log message outputting the consumerID and the value of the item consumed;
-
-  	B. Set the Env of ledSrvTask (using Task_setEnv API function) to send it the up-to-dated
-  	   data for the Led Blink (i.e. sending it a pointer to the local LedBlinksInfo_T structure
-  	   that you must also update it with the proper information before that!)
-
-  	C. Release ledSrvTask to work (by posting the Scheduling Constraint Semaphore
-  	   ledSrvSchedSem, which ledSrvTask pends on).
-
-  	Now, since ledSrvTask is the highest priority Task in the system, it will immediately get
-  	to run and blink the appropriate Led (according to the specification you updated in
-  	LedBlinksInfo_T structure and sent it to ledSrvTask's Env).
+  	A. Issue a Log message outputting the consumerID and the value of the item consumed, and
+  	   serve the item (serviceItem - takes time according to the SERVICE model);
 
-  	However, what happens if current Task yielded (by timeSharingClk), just after setting the
-  	ledSrvTask's Env, but before posting ledSrvSchedSem (i.e. before releasing ledSrvTask)???
-  	Some other producerTask/consumerTask may set ledSrvTask's Env with their data -
-  	running over the data set by current Task...!!! Reminds you of something???
-  	Indeed, this is RACE CONDITION!!!
+  	B. Update the local LedBlinksInfo_T structure with the data for the Led Blink and hand it
+  	   to prepForLedSrv, which copies it into the LED request queue and releases ledSrvTask to
+  	   work (by posting the Scheduling Constraint Semaphore ledSrvSchedSem, which ledSrvTask
+  	   pends on). prepForLedSrv returns right away - the blinking itself is done later, by
+  	   ledSrvTask, according to the copy in the queue.
 
-  	This means that the ENTIRE CODE in sections B & C above is a CRITICAL SECTION!!!! It must,
-  	therefore, be protected by a Mutex Semaphore (we named this Mutex Semaphore: setLedEnvMutex).
+  	The queue is shared by all producerTasks/consumerTasks and by ledSrvTask, so adding a
+  	request to it is a CRITICAL SECTION - it is protected by the Mutex Semaphore
+  	setLedEnvMutex (see prepForLedSrv). It is a short one, though: only the copy of the request.
 
   4) Go back to the beginning of the while(TRUE) loop;
  */
@@ -309,19 +895,22 @@ void consumerHandler(UArg arg0, UArg arg1);
  Function: ledSrvTaskHandler(void)
 
  This is the handling function for ledSrvTask. This is the highest priority Task in the system,
- so when it is scheduled (i.e. not pending on the Scheduling Constraint Semaphore:
- ledSrvSchedSem) - it will occupy the CPU exclusively! The role of this Task is to wait on the
+ so while it is ready it preempts every producerTask/consumerTask. It is, however, ready only
+ for a moment at a time: the blinking itself is timed by the ledBlinkClk Clock object (see
+ ledToggle), and while a blink pattern is running ledSrvTask is blocked on ledBlinkDoneSem -
+ producers and consumers keep running. The role of this Task is to wait on the
  Scheduling Constraint Semaphore, ledSrvSchedSem, and whenever an event is posted it should:
 
-  - Read its own (SELF!!) environment data, in order to get the Led blinking specification (Recall:
-    consumerTask/producerTask updated ledSrvTask's Env with this specification, just before
-    posting ledSrvSchedSem). This is done by calling Task_getEnv API function on SELF (Recall: the
-    return value of Task_getEnv is of type Ptr (defined in BIOS as void *) - this should be
-    casted to LedBlinksInfo_T *, in this case).
+  - Take the next Led blinking specification out of the LED request queue (Recall:
+    consumerTask/producerTask added it to the queue, just before posting ledSrvSchedSem).
+    This is done by calling ledQueueGet, which copies the request to a local structure.
 
-  - Blink the Led, according to the Led specification set by consumerTask/producerTask to
-   ledSrvTask's Env - this is, in fact, done by simply calling ledToggle function with the
-   parameters corresponding to the Led specification read from ledSrvTask's own Env!
+  - Blink the Led, according to that specification - this is, in fact, done by simply calling
+    ledToggle function with the parameters corresponding to the Led specification, and then
+    pending on ledBlinkDoneSem until the blink pattern is over!
+
+  - repeat the above as long as the queue is not empty (ledSrvSchedSem is a binary semaphore,
+    so one post may stand for several queued requests).
 
   - get back to pend on ledSrvSchedSem Scheduling Constraint Semaphore.
 
@@ -336,36 +925,38 @@ void ledSrvTaskHandler(void);
  Function: void ledToggle(uint8_t selectedPort, uint16_t selectedPins, int times)
 
  This function is very similar to what you implemented in Lab 1: gets LED Port/Pin and times
- and toggles the corresponding LED times times.
+ and toggles the corresponding LED times times, with LED_TOGGLE_TICKS Clock ticks (~1/8 of a
+ second, unless changed by ledSetMaxBlinkRate) between ON/OFF states of the Led.
+
+ Unlike Lab 1, it does not wait between toggles: the first toggle is done right away, and the
+ rest are done by ledBlinkClkHandler, which runs when the one-shot ledBlinkClk Clock object
+ expires and restarts it for the next toggle. The pattern ends with one more LED_TOGGLE_TICKS
+ gap after the last toggle (so that back-to-back requests are still told apart), and then
+ ledBlinkDoneSem is posted. ledToggle returns immediately - the caller (ledSrvTask) pends on
+ ledBlinkDoneSem before starting the next pattern, so no CPU cycles are burnt on the delay.
+ If times is not positive, ledBlinkDoneSem is posted right away.
+ */
+void ledToggle(uint8_t selectedPort, uint16_t selectedPins, int times);
+
 
- As you recall, a delay of 1/2 a second should be set between ON/OFF states of the Led.
- Note, in this project, you must use the delay function "delay" implemented here - see below
- (This delay function is similar to what you used in Lab 3, only that in this project, the Clock
- Module is set to tick every 500 microseconds, so the ~1/2 second delay value here is set with
- respect to 500 microseconds Clock tick - different to that in Lab3!).
+/*
+ Function: void ledSetMaxBlinkRate(UInt blinksPerSec)
 
- Recall, "delay" function consumes CPU Cycles for 1/2 second. You must use this function in the
- ledToggle function, rather than Task_sleep function, because Task_sleep function blocks on a
- timer for N milliseconds, and while blocking, another Task (with highest priority in the
- Ready Queue) gets to run, until Task unblocks from sleep! In this project, if you get
- ledSrvTask to release the CPU - you break the system requirements - and might get into
- trouble!!! Therefore, you have no choice, but to use a non-blocking delay here!
+ Limits the LED blinking rate to blinksPerSec blinks (ON + OFF) per second, by setting the
+ number of Clock ticks between toggles (at least one tick). 0 restores LED_TOGGLE_TICKS.
+ Takes effect with the next blink pattern; main() applies LED_MAX_BLINK_RATE.
  */
-void ledToggle(uint8_t selectedPort, uint16_t selectedPins, int times);
+void ledSetMaxBlinkRate(UInt blinksPerSec);
 
 
 /*
- Function: void delay(void)
+ Function: void ledBlinkClkHandler(UArg arg)
 
- The delay function, used in lab 3. This function consumes CPU Cycles for 1/2 second.
- You must use this function in the LED toggling function, rather than Task_sleep function,
- because Task_sleep function blocks on a timer for N milliseconds, and while blocking, another
- Task (with highest priority in the Ready Queue) gets to run, until Task unblocks from sleep!
- In this project, if you get ledSrvTask to release the CPU - you break the system requirements
- - and might get into trouble!!! Therefore, you have no choice, but to use a non-blocking
- delay here!
+ The handler function for the one-shot ledBlinkClk Clock object: toggles the Led selected by
+ ledToggle and restarts ledBlinkClk while toggles are left; posts ledBlinkDoneSem once the
+ trailing gap of the pattern has elapsed.
  */
-void delay(void);
+void ledBlinkClkHandler(UArg arg);
 
 
 /*
@@ -377,330 +968,3089 @@ void delay(void);
  get the running Task to yield (You should know how to do that by now). If you set the Clock
  Module's "Tick period" to 500 microseconds (and NOT the default 1000 microseconds), what
  should be timeSharingClk "Initial timeout" and "period" set to in GUI?
+
+ With TIME_SLICE_ADAPTIVE the yield is only forced once the running Task has used up its
+ quantum and another Task of its priority is ready (see TIME_SLICE).
  */
 void tsClockHandler(void);
 
 
 /*
- Function: initArray(volatile Int *arr, Int size)
+ Function: initArray(volatile UChar *arr, Int size)
 
- This function initialises the shared buffer array to hold -1 in ALL its cells.
- Recall, -1 marks an empty cell in the shared buffer! Therefore, initially ALL cells are empty!
+ This function initialises the occupancy map of the shared buffer (slotFull) to mark ALL its
+ cells as empty. (The buffer itself used to hold -1 in an empty cell - the occupancy is now kept
+ out of the buffer, so that every item value can be stored.)
 
- Of course, this function must be invoked from main function to initialise the shared
- buffer array - before BIOS kernel objects start running!
+ Of course, this function must be invoked from main function (in BUFFER_CHECKED builds) to
+ initialise the occupancy map - before BIOS kernel objects start running!
  */
-void initArray(volatile Int *arr, Int size);
+void initArray(volatile UChar *arr, Int size);
 
-void printErrorMessage(char* errorMsg, Int msgArg1);
+//TraceEvent_E enum - TRACE_<name> for every event of trace_events.h
+typedef enum
+{
+#define TRACE_EVENT(name, level, category, format) TRACE_##name,
+#include "trace_events.h"
+#undef TRACE_EVENT
+	TRACE_EVENT_COUNT
+} TraceEvent_E;
+
+//The level (TRACE_LEVEL_OF_<name>) and category (TRACE_CATEGORY_OF_<name>) of every event, for TRACE_DEBUG/TRACE_INFO/TRACE_ERROR
+enum
+{
+#define TRACE_EVENT(name, level, category, format) \
+	TRACE_LEVEL_OF_##name = TRACE_LEVEL_##level, TRACE_CATEGORY_OF_##name = TRACE_CATEGORY_##category,
+#include "trace_events.h"
+#undef TRACE_EVENT
+	TRACE_OF_END
+};
 
-void printMessage(char* msg, Int msgArg1, Int msgArg2);
+/*
+ TraceRecord_T - one event in the trace ring: when it happened (Timestamp_get32()), its two
+ arguments, the event (TraceEvent_E) and the ID of the Task which raised it (taskId; 0 - none).
+ Arguments are kept as 16 bits, the size of an Int on MSP430.
+
+ TraceBuffer_T - the trace ring: "head" counts all the events ever written, so the latest
+ record is records[(head - 1) % TRACE_RING_SIZE] and, once head passes TRACE_RING_SIZE, the
+ oldest one is records[head % TRACE_RING_SIZE]. On MSP430 "head" takes 4 bytes and a record
+ 10 (little endian, no padding) - the layout host/trace_decode.c expects.
+ */
+typedef struct
+{
+	UInt32 timestamp;
+	UInt16 arg1;
+	UInt16 arg2;
+	UInt8 event;
+	UInt8 task;
+}TraceRecord_T;
 
-void prepForLedSrv(LedBlinksInfo_T* ledBlinkInfo);
+typedef struct
+{
+	volatile UInt32 head;
+	TraceRecord_T records[TRACE_RING_SIZE];
+}TraceBuffer_T;
 
-//-----------------------------------------
-// Globals
-//-----------------------------------------
+/*
+ Function: void traceEvent(TraceEvent_E event, Int arg1, Int arg2)
 
+ Reports an event of trace_events.h according to TRACE_SINK: as a Log_info of its format and
+ arguments (TRACE_SINK_LOG), as a record in traceBuffer (TRACE_SINK_RING - a handful of
+ stores with interrupts disabled, cheap enough to stay on in production), or not at all.
+ Called through TRACE_DEBUG/TRACE_INFO/TRACE_ERROR(name, arg1, arg2), which filter by
+ TRACE_LEVEL and traceMask first.
+ */
+void traceEvent(TraceEvent_E event, Int arg1, Int arg2);
 
 /*
- The shared buffer array.
+ Function: UInt traceSetMask(UInt mask)
+
+ Sets traceMask - the TRACE_CATEGORY_* bits of the events to report - and returns the old
+ one. Takes effect at once, from any Task.
  */
-volatile Int buffer[BUFFER_SIZE];
+UInt traceSetMask(UInt mask);
 
 /*
- This global variable always manages the next empty slot in the shared buffer - see the
- description of the functions: insert_item & remove_item.
+ Function: Bool traceEntry(UInt32 index, TraceRecord_T *record)
+
+ Copies record number "index" of the trace ring, counting from the oldest one still kept (0).
+ Returns FALSE past the latest record - used to export the ring (TRACE_SINK_RING only).
+ Meant for a stopped system: a record written meanwhile may overwrite the one being copied.
  */
-volatile Int in = 0;
+Bool traceEntry(UInt32 index, TraceRecord_T *record);
 
 /*
- This global variable always manages the next full slot in the shared buffer - see the
- description of the functions: insert_item & remove_item.
+ Function: void prepForLedSrv(const LedBlinksInfo_T* ledBlinkInfo)
+
+ Adds a copy of *ledBlinkInfo to the LED request queue (applying LED_QUEUE_POLICY if it is
+ full) and releases ledSrvTask by posting ledSrvSchedSem. Never waits for ledSrvTask.
  */
-volatile Int out = 0;
+void prepForLedSrv(const LedBlinksInfo_T* ledBlinkInfo);
 
 /*
- This global variable always manages the count of current full slots in the shared buffer -
- see the description of the functions: insert_item & remove_item.
+ Function: Bool ledQueueGet(LedBlinksInfo_T* ledBlinkInfo)
+
+ Takes the oldest request out of the LED request queue, copying it to *ledBlinkInfo.
+ Returns FALSE (leaving *ledBlinkInfo untouched) if the queue is empty.
  */
-volatile Int count = 0;
+Bool ledQueueGet(LedBlinksInfo_T* ledBlinkInfo);
 
+/*
+ Function: Bool atomicExchange(volatile Bool *flag, Bool value)
 
-//---------------------------------------------------------------------------
-// main()
-//---------------------------------------------------------------------------
-void main(void)
-{
-	hardware_init();
-	Semaphore_reset(emptySlots, BUFFER_SIZE);
-	initArray(buffer, BUFFER_SIZE);
-	BIOS_start();
-}
+ Stores "value" to *flag and returns the previous value of *flag as one indivisible
+ operation. Used by the SPSC buffer engine to hand a wakeup over between the producer and
+ the consumer (see insert_item/remove_item of BUFFER_ENGINE_SPSC).
+ */
+Bool atomicExchange(volatile Bool *flag, Bool value);
 
-void hardware_init(void)
-{
-	// Disable the Watchdog Timer (important, as this is enabled by default)
-	WDT_A_hold( WDT_A_BASE );
+/*
+ Function: Bool atomicCompareExchange(volatile Int *var, Int expected, Int desired)
 
-	// Set MCLK frequency to 8192 KHz
-	// First, set DCO FLLREF to 32KHz = REF0
-	UCS_initClockSignal(UCS_FLLREF, UCS_REFOCLK_SELECT, UCS_CLOCK_DIVIDER_1);
-	// Second, Set Ratio and Desired MCLK Frequency = 8192KHz and initialize DCO
-	UCS_initFLLSettle(MCLK_DESIRED_FREQUENCY_IN_KHZ, MCLK_FLLREF_RATIO);
+ If *var still holds "expected", replaces it with "desired" and returns TRUE - otherwise
+ leaves it alone and returns FALSE, as one indivisible operation. Used by the MPMC buffer
+ engine to claim buffer positions (see insert_item/remove_item of BUFFER_ENGINE_MPMC).
+ */
+Bool atomicCompareExchange(volatile Int *var, Int expected, Int desired);
 
-	// Set GPIO ports to low-level outputs
-	GPIO_setAsOutputPin( GPIO_PORT_P1, GPIO_ALL );
-	GPIO_setAsOutputPin( GPIO_PORT_P2, GPIO_ALL );
-	GPIO_setAsOutputPin( GPIO_PORT_P3, GPIO_ALL );
-	GPIO_setAsOutputPin( GPIO_PORT_P4, GPIO_ALL );
-	GPIO_setAsOutputPin( GPIO_PORT_P5, GPIO_ALL );
-	GPIO_setAsOutputPin( GPIO_PORT_P6, GPIO_ALL );
-	GPIO_setAsOutputPin( GPIO_PORT_PJ, GPIO_ALL );
+/*
+ Functions: UInt32 rngSeed(UArg id) / UInt32 rngNext(UInt32 *state) /
+ 			Int rngRange(UInt32 *state, UInt32 range)
+
+ A small pseudo-random generator (xorshift32) whose state is a local variable of each
+ producerTask, so producers share no generator state and need no reseeding. rngSeed mixes
+ the producer ID with RNG_SEED (or, if it is 0, with RNG_ENTROPY() - see RNG_SEED) into a
+ non-zero initial state. rngNext advances the state and returns it; rngRange returns a
+ uniformly distributed value in 0..range-1 using a multiply and a shift instead of "%"
+ (rejecting the few values which would bias the result).
+ */
+UInt32 rngSeed(UArg id);
+UInt32 rngNext(UInt32 *state);
+Int rngRange(UInt32 *state, UInt32 range);
 
-	GPIO_setOutputLowOnPin( GPIO_PORT_P1, GPIO_ALL );
-	GPIO_setOutputLowOnPin( GPIO_PORT_P2, GPIO_ALL );
-	GPIO_setOutputLowOnPin( GPIO_PORT_P3, GPIO_ALL );
-	GPIO_setOutputLowOnPin( GPIO_PORT_P4, GPIO_ALL );
-	GPIO_setOutputLowOnPin( GPIO_PORT_P5, GPIO_ALL );
-	GPIO_setOutputLowOnPin( GPIO_PORT_P6, GPIO_ALL );
-	GPIO_setOutputLowOnPin( GPIO_PORT_PJ, GPIO_ALL );
-}
+/*
+ Function: void rngEntropyInit(void)
 
-/*---------------------------------------------------------------------------
-Function name: delay
-Description: Busy-waiting loop
-Input: None
-Output: None
-Algorithm: 1/2s delay.
----------------------------------------------------------------------------*/
-void delay(void)
-{
-	// ~1/2 second delay providing Clock Module is set to tick every 500 microseconds
-	// (i.e every 1/2 milisecond, rather than every 1 milisecond).
-	__delay_cycles(1024000);
-}
+ Sets rngBootEntropy from the noise of the ADC12 temperature sensor readings (target only;
+ 0 on the host). Called by main before BIOS_start, as it uses the ADC12 and REF modules and
+ busy-waits for them; it leaves both off again.
+ */
+void rngEntropyInit(void);
 
-/*---------------------------------------------------------------------------
-Function name: initArray
-Description: Initialize buffer.
-Input: volatile Int *arr, Int size
-Output: None
-Algorithm: insert -1 in each buffer space.
----------------------------------------------------------------------------*/
-void initArray(volatile Int *arr, Int size)
+/*
+ Workload_T - the workload model state of one producerTask (a local variable of
+ producerHandler): its random generator, the mean gap between its items, and when its next
+ item is due - a Clock tick plus the microseconds into that tick. "phaseUs" is the position
+ in the on/off cycle (WORKLOAD_BURSTY) and "traceIndex" the next trace entry (WORKLOAD_TRACE).
+ */
+typedef struct
 {
-	while(size > 0)
-		arr[--size] = EMPTY_SLOT_IND;
-}
+	UInt32 rng;
+	UInt32 meanGapUs;
+	UInt32 dueTick;
+	UInt32 dueUs;
+	UInt32 phaseUs;
+	Int traceIndex;
+}Workload_T;
 
-/*---------------------------------------------------------------------------
-Function name: tsClockHandler
-Description: The clock function
-Input: None
-Output: None
-Algorithm: Yields the current task every 0.5ms to create a time-sharing
-		   mechanism.
----------------------------------------------------------------------------*/
-void tsClockHandler(void)
-{
-	Task_yield();
-}
+/*
+ Functions: void workloadInit(Workload_T *workload, UArg producerId) /
+ 			Int workloadNext(Workload_T *workload)
+
+ workloadInit sets up the workload model of producer producerId (seeding its generator and
+ taking its rate from WORKLOAD_RATES); the first item is due right away. workloadNext
+ sleeps (Task_sleep) until the next item is due, schedules the one after it according to
+ WORKLOAD, and returns the value of the item - random in MIN_VAL_NUM..MAX_VAL_NUM, or taken
+ from the trace. If the producer fell behind (insert_item blocked), due items are produced
+ back to back until it has caught up.
+ */
+void workloadInit(Workload_T *workload, UArg producerId);
+Int workloadNext(Workload_T *workload);
 
-/*---------------------------------------------------------------------------
-Function name: producerHandler
-Description: The producers task.
-Input: UArg arg0, UArg arg1
-Output: None
-Algorithm: Activates insert_item function to insert an item to the buffer,
-		   if succeeded- print a log message, update his ledBlinkInfo and
-		   send it to prepForLedSrv function.
----------------------------------------------------------------------------*/
-void producerHandler(UArg arg0, UArg arg1)
+/*
+ Service_T - the service-time model state of one consumerTask (a local variable of
+ consumerHandler): its random generator, its mean service time and the service time not
+ slept yet (less than one Clock tick).
+ */
+typedef struct
 {
-	LedBlinksInfo_T ledBlinkInfo;
-	Int prodItem;
-	while(TRUE)
-	{
-		srand(time(NULL));
-		prodItem = rand() % (MAX_VAL_NUM - MIN_VAL_NUM + 1) + MIN_VAL_NUM;
-		if(!insert_item(prodItem))
-		{
-			printErrorMessage("ProducerID = %u:: Error, could not insert item!", arg0);
-			continue;
-		}
-		printMessage("ProducerID = %u; Produced Item = %u", arg0, prodItem);
-		ledBlinkInfo.led = green_e;
-		ledBlinkInfo.blinksNum = prodItem;
-		prepForLedSrv(&ledBlinkInfo);
-	}
-}
+	UInt32 rng;
+	UInt32 meanUs;
+	UInt32 owedUs;
+}Service_T;
 
-/*---------------------------------------------------------------------------
-Function name: consumerHandler
-Description: The consumers task.
-Input: UArg arg0, UArg arg1
-Output: None
-Algorithm: Activates remove_item function to remove an item from the buffer,
-		   if succeeded- print a log message, update his ledBlinkInfo and
-		   send it to prepForLedSrv function.
----------------------------------------------------------------------------*/
-void consumerHandler(UArg arg0, UArg arg1)
-{
-	LedBlinksInfo_T ledBlinkInfo;
-	Int consItem;
-	while(TRUE)
-	{
-		if(!remove_item(&consItem))
-		{
-			printErrorMessage("ConsumerID = %u:: Error, could not remove item!", arg0);
-			continue;
-		}
-		printMessage("ConsumerID = %u; Removed Item = %u", arg0, consItem);
-		ledBlinkInfo.led = red_e;
-		ledBlinkInfo.blinksNum = consItem;
-		prepForLedSrv(&ledBlinkInfo);
-	}
-}
+/*
+ Functions: void serviceInit(Service_T *service, UArg consumerId) /
+ 			void serviceItem(Service_T *service, Int value)
 
-/*---------------------------------------------------------------------------
-Function name: prepForLedSrv
-Description: Environment critical section
+ serviceInit sets up the service-time model of consumer consumerId (seeding its generator
+ and taking its mean from SERVICE_TIMES_US). serviceItem draws the service time of an item
+ of the given value according to SERVICE and sleeps for it (in whole Clock ticks, carrying
+ the remainder to the next item).
+ */
+void serviceInit(Service_T *service, UArg consumerId);
+void serviceItem(Service_T *service, Int value);
+
+/*
+ Functions: Int pendUpTo(Semaphore_Handle sem, Int n) / void postN(Semaphore_Handle sem, Int n)
+
+ Bulk counting semaphore operations for the batch API: pendUpTo blocks until one unit of
+ "sem" is available and then takes up to n-1 more without blocking, returning how many
+ were taken; postN gives n units back. Both make one Semaphore call per unit - BIOS has no
+ call which takes or gives several units at once.
+ */
+Int pendUpTo(Semaphore_Handle sem, Int n);
+void postN(Semaphore_Handle sem, Int n);
+
+/*
+ SPSC buffer engine helpers (see insert_item/remove_item of BUFFER_ENGINE_SPSC):
+ spscWaitForRoom/spscWaitForItems return how many slots/items are available to the producer/
+ consumer, blocking only when there are none - for up to "timeout" Clock ticks, after which
+ they return 0; spscPublishIn/spscPublishOut make the new "in"/"out" visible to the other side
+ and wake it up if it is waiting.
+ */
+Int spscWaitForRoom(Int head, Int wanted, UInt32 timeout);
+Int spscWaitForItems(Int tail, Int wanted, UInt32 timeout);
+void spscPublishIn(Int head);
+void spscPublishOut(Int tail);
+
+/*
+ LatencyStats_T - a summary of latencyHist, in Timestamp_get32() units (see
+ Timestamp_getFreq): the number of items measured and the 50th/99th/99.9th percentile and
+ maximum of their buffer latency. A percentile is the upper edge of its histogram bucket
+ (never above the maximum).
+ */
+typedef struct
+{
+	UInt32 count;
+	UInt32 p50;
+	UInt32 p99;
+	UInt32 p999;
+	UInt32 max;
+}LatencyStats_T;
+
+/*
+ Function: void latencyRecord(UInt32 latency)
+
+ Adds one latency to latencyHist and latencyMax. Called by remove_item for every consumed
+ item (SLOT_LATENCY); safe to call from any number of Tasks at once.
+ */
+void latencyRecord(UInt32 latency);
+
+/*
+ Function: void latencySnapshot(LatencyStats_T *stats)
+
+ Summarises latencyHist into *stats. Reads the histogram without locking it, so it never
+ stalls producers/consumers - items recorded meanwhile may or may not be counted.
+ */
+void latencySnapshot(LatencyStats_T *stats);
+
+/*
+ Function: void latencyDump(void)
+
+ Logs a latencySnapshot (Log_info) - call it whenever the figures are wanted.
+ */
+void latencyDump(void);
+
+/*
+ Function: void stackDump(void)
+
+ Logs (Log_info) the stack high-water mark of every statically created Task - the producers,
+ the consumers, ledSrvTask and the idle Task - and of the system stack (Program.stack, used
+ by Hwis and Swis, i.e. the Clock handlers), next to the stack sizes set in empty.cfg.
+ The marks come from Task_stat/Hwi_getStackInfo, which find the deepest byte of the stack
+ the Task ever changed (BIOS fills the stacks with a known pattern at start-up), so run the
+ system through its heaviest paths first. See empty.cfg for how the sizes were chosen.
+ */
+void stackDump(void);
+
+/*
+ SemProfile_T - the semProfile entry of one Task and one semaphore: successful pends, the
+ ones among them which had to block, pends which failed (timeout/BIOS_NO_WAIT), posts, and
+ the total/maximum time spent blocked in Timestamp_get32() units.
+ */
+typedef struct
+{
+	UInt32 acquired;
+	UInt32 blocked;
+	UInt32 failed;
+	UInt32 posts;
+	UInt64 waitTotal;
+	UInt32 waitMax;
+}SemProfile_T;
+
+/*
+ Functions: Bool semProfiledPend(Semaphore_Handle sem, UInt32 timeout) /
+ 			void semProfiledPost(Semaphore_Handle sem)
+
+ Semaphore_pend/Semaphore_post plus accounting in the calling Task's semProfile row (SEM_PEND/
+ SEM_POST with SEM_PROFILE). The pend first tries BIOS_NO_WAIT, so only a pend which really
+ blocks is timed. Task context only - the row of a Task is its taskId - 1.
+ */
+Bool semProfiledPend(Semaphore_Handle sem, UInt32 timeout);
+void semProfiledPost(Semaphore_Handle sem);
+
+/*
+ Function: Bool semProfileEntry(Int row, Int sem, Task_Handle *task, String *semName,
+ 								SemProfile_T *entry)
+
+ Copies the semProfile entry of row "row" (a Task) and semaphore number "sem" (0 to
+ SEM_PROFILE_SEMS-1), with the Task and the semaphore name. Returns FALSE if there is no such
+ row or semaphore - used to export the table.
+ */
+Bool semProfileEntry(Int row, Int sem, Task_Handle *task, String *semName, SemProfile_T *entry);
+
+/*
+ Function: void semProfileDump(void)
+
+ Logs every non-empty semProfile entry (Log_info): Task, semaphore, counts, and the average
+ and maximum blocked time.
+ */
+void semProfileDump(void);
+
+//TaskStats_T, StatsSnapshot_T, statsTaskSnapshot and statsSnapshot - shared with the host report
+#include "task_stats.h"
+
+/*
+ StatsRow_T - the statsRows entry of one Task. "counts" is written only by "task", through
+ statsAdd, which makes "seq" odd while it updates a counter and even again afterwards (a
+ sequence lock): a reader that sees the same even "seq" before and after copying the counters
+ has a consistent copy, and otherwise simply reads again. So neither side ever waits for the
+ other, and a 32 bit counter is never read half-updated (MSP430 stores it as two words).
+ */
+typedef struct
+{
+	Task_Handle task;
+	UInt seq;
+	TaskStats_T counts;
+}StatsRow_T;
+
+/*
+ Function: Int taskId(void)
+
+ The ID of the running Task: its statsRows row + 1. The first call of a Task claims the next
+ free row (Tasks get IDs in the order they start) and keeps the ID in the Task's Env. Returns
+ 0 for a Task which found statsRows full.
+ */
+Int taskId(void);
+
+/*
+ Function: volatile StatsRow_T *statsRegister(void)
+
+ Claims a statsRows row for the running Task and returns it - called once, when a
+ producerTask/consumerTask/ledSrvTask starts, which then keeps the row in a local variable.
+ If statsRows is full, returns a scratch row which is never read.
+ */
+volatile StatsRow_T *statsRegister(void);
+
+/*
+ Function: void statsAdd(volatile StatsRow_T *row, volatile UInt32 *counter, UInt32 n)
+
+ Adds n to *counter, a counter of "row" (e.g. &row->counts.produced). Only the Task owning
+ the row may call it. No lock: three stores.
+ */
+void statsAdd(volatile StatsRow_T *row, volatile UInt32 *counter, UInt32 n);
+
+/*
+ Function: void statsDump(void)
+
+ Logs a statsSnapshot (Log_info).
+ */
+void statsDump(void);
+
+/*
+ Function: Bool backpressureAdmit(volatile StatsRow_T *row, Int items)
+
+ The producer side of BACKPRESSURE, called by a producerTask with the "items" it has just
+ generated, before it inserts them: BACKPRESSURE_THROTTLE sleeps while backpressure is on
+ (each sleep counted in row->counts.throttled); BACKPRESSURE_SHED sleeps once and returns FALSE
+ while it is on (the items counted in row->counts.shed) - the producer then drops them. The
+ sleep paces the producer, which would otherwise spin generating and dropping items without
+ ever blocking. Otherwise TRUE.
+ */
+Bool backpressureAdmit(volatile StatsRow_T *row, Int items);
+
+/*
+ TimeSlice_T - the time slicing figures of one Task (TIME_SLICE_ADAPTIVE), kept in
+ timeSlice[] by statsRows row: the Clock ticks at which it was the running Task, the yields
+ tsClockHandler forced on it, and the ticks past its quantum at which no other Task of its
+ priority was ready (each one a yield saved). Written only by tsClockHandler.
+ */
+typedef struct
+{
+	UInt32 ticks;
+	UInt32 yields;
+	UInt32 kept;
+}TimeSlice_T;
+
+/*
+ Function: Bool timeSlicePeerReady(Task_Handle self, Int priority)
+
+ Whether a Task with a statsRows row, other than "self", is ready at "priority". Called by
+ tsClockHandler on every tick past a quantum, so it reads only the priority and mode of each
+ Task (Task_getPri/Task_getMode - not Task_stat, which also scans the Task's stack), and
+ starts with the peer it found ready last time (sliceHint), which is usually still ready.
+ */
+Bool timeSlicePeerReady(Task_Handle self, Int priority);
+
+/*
+ Function: Bool timeSliceSnapshot(Int row, TimeSlice_T *slice)
+
+ Copies the time slicing figures of statsRows row "row". Returns FALSE if there is no such
+ row.
+ */
+Bool timeSliceSnapshot(Int row, TimeSlice_T *slice);
+
+/*
+ Function: void timeSliceWake(void)
+
+ Starts timeSharingClk again if tsClockHandler stopped it (TICKLESS) - called after every
+ SEM_POST, since a post may have readied a Task of the running Task's priority.
+ */
+void timeSliceWake(void);
+
+/*
+ BackpressureFxn - a backpressure callback (see BACKPRESSURE and backpressureSetCallback):
+ called with TRUE when backpressure turns on and FALSE when it turns off, and the occupancy
+ which made it change. It runs in the producerTask/consumerTask whose insert/remove crossed
+ the watermark, so it must be short and must not block. If that Task is preempted between the
+ change and the call, the next change may be reported first - backpressureOn is the truth.
+ */
+typedef void (*BackpressureFxn)(Bool on, Int occupancy);
+
+/*
+ Function: Int bufferOccupancy(void)
+
+ The number of items in the shared buffer: "count" (semaphore engine) or the distance between
+ "out" and "in" (SPSC/MPMC engines). Read without locking, so it may be a moment old, and in
+ the MPMC engine it includes the positions claimed by producers still copying their items.
+ */
+Int bufferOccupancy(void);
+
+/*
+ Function: void backpressureUpdate(void)
+
+ Compares bufferOccupancy with the watermarks, turns backpressure on or off accordingly and
+ calls the callback on every change. Called by the producers after every insert and by the
+ consumers after every remove (BACKPRESSURE builds).
+ */
+void backpressureUpdate(void);
+
+/*
+ Functions: BackpressureFxn backpressureSetCallback(BackpressureFxn fxn) /
+ 			Bool backpressureSetWatermarks(Int high, Int low)
+
+ backpressureSetCallback sets the function called on every backpressure change (NULL - none)
+ and returns the old one. backpressureSetWatermarks replaces BACKPRESSURE_HIGH/LOW; it returns
+ FALSE, changing nothing, unless 0 <= low < high <= BUFFER_SIZE. Both take effect at once,
+ from any Task.
+ */
+BackpressureFxn backpressureSetCallback(BackpressureFxn fxn);
+Bool backpressureSetWatermarks(Int high, Int low);
+
+/*
+ Function: void consumerSetPriority(UArg consumerId)
+
+ Sets the priority of the running consumerTask to the entry of consumer consumerId in
+ CONSUMER_PRIORITIES (Task_setPri), unless that entry is 0 - see CONSUMER_PRIORITIES.
+ */
+void consumerSetPriority(UArg consumerId);
+
+//-----------------------------------------
+// Globals
+//-----------------------------------------
+
+#if SEM_PROFILE
+/*
+ Semaphore wait profile: semProfile[row][sem] is written only by the Task of the row
+ (statsRows[row].task), so no locking is needed.
+ */
+SemProfile_T semProfile[STATS_TASKS][SEM_PROFILE_SEMS];
+#endif
+
+#if LATENCY_STATS
+/*
+ Per-item latency: slotStamp[i] is the Timestamp_get32() of the item in buffer[i] (written
+ with the item), latencyHist the histogram of the measured latencies and latencyMax the
+ largest one (see latencyRecord).
+ */
+UInt32 slotStamp[BUFFER_SIZE];
+volatile UInt32 latencyHist[LATENCY_BUCKETS];
+volatile UInt32 latencyMax = 0;
+#endif
+
+/*
+ The TRACE_CATEGORY_* bits of the events which are reported (see TRACE_AT).
+ */
+volatile UInt traceMask = TRACE_MASK;
+
+#if TRACE_SINK == TRACE_SINK_LOG
+/*
+ The Log format of every trace event (see trace_events.h), indexed by TraceEvent_E.
+ */
+const String traceFormats[TRACE_EVENT_COUNT] = {
+#define TRACE_EVENT(name, level, category, format) format,
+#include "trace_events.h"
+#undef TRACE_EVENT
+};
+#elif TRACE_SINK == TRACE_SINK_RING
+/*
+ The trace ring (see TraceBuffer_T) - save it from the memory browser for host/trace_decode.c.
+ */
+TraceBuffer_T traceBuffer;
+#endif
+
+/*
+ The blink pattern currently run by ledBlinkClk (see ledToggle): the Led's port/pins and the
+ number of toggles left.
+ */
+uint8_t ledBlinkPort;
+uint16_t ledBlinkPins;
+volatile Int ledTogglesLeft = 0;
+UInt32 ledToggleTicks = LED_TOGGLE_TICKS;
+
+/*
+ The LED request queue - see LedBlinksInfo_T. ledQueueHead is the oldest queued request,
+ ledQueueCount the number of queued requests. Protected by setLedEnvMutex.
+ */
+LedBlinksInfo_T ledQueue[LED_QUEUE_SIZE];
+Int ledQueueHead = 0;
+Int ledQueueCount = 0;
+
+/*
+ LED request queue statistics: requests merged into a queued one (LED_POLICY_COALESCE) and
+ requests lost because the queue was full. (The requests posted are counted per Task, in
+ statsRows.)
+ */
+volatile UInt32 ledRequestsCoalesced = 0;
+volatile UInt32 ledRequestsDropped = 0;
+
+/*
+ The hardware noise the producer/consumer seeds start from (RNG_ENTROPY) - set once by
+ rngEntropyInit, before any Task runs.
+ */
+UInt32 rngBootEntropy = 0;
+
+
+/*
+ The shared buffer array.
+ */
+volatile BufferItem_T buffer[BUFFER_SIZE];
+
+#if BUFFER_CHECKED
+/*
+ Occupancy map of the shared buffer: slotFull[i] is TRUE while buffer[i] holds an item which
+ was not consumed yet. One byte per slot (not one bit), so that Tasks updating different
+ slots never share a read-modify-write.
+ */
+volatile UChar slotFull[BUFFER_SIZE];
+#endif
+
+/*
+ This global variable always manages the next empty slot in the shared buffer - see the
+ description of the functions: insert_item & remove_item.
+ */
+volatile Int in = 0;
+
+/*
+ This global variable always manages the next full slot in the shared buffer - see the
+ description of the functions: insert_item & remove_item.
+ */
+volatile Int out = 0;
+
+/*
+ This global variable always manages the count of current full slots in the shared buffer -
+ see the description of the functions: insert_item & remove_item.
+ */
+volatile Int count = 0;
+
+/*
+ Per-Task counters (see StatsRow_T): statsRows[0..statsTaskCount-1] are claimed by the Tasks
+ in the order they start; Tasks which find the table full count in statsScratch instead
+ (never read) and are counted in statsUntracked.
+ */
+volatile StatsRow_T statsRows[STATS_TASKS];
+volatile Int statsTaskCount = 0;
+volatile Int statsUntracked = 0;
+volatile StatsRow_T statsScratch;
+
+#if TIME_SLICE == TIME_SLICE_ADAPTIVE
+/*
+ Time slicing state of tsClockHandler: the figures of every Task (by statsRows row), the row
+ of the Task found running at the last Clock tick and the ticks of its quantum used so far.
+ */
+volatile TimeSlice_T timeSlice[STATS_TASKS];
+Int sliceRow = -1;
+UInt sliceUsed = 0;
+Int sliceHint = 0;					//statsRows row timeSlicePeerReady found ready last
+#endif
+
+#if TICKLESS
+/*
+ TRUE while tsClockHandler has timeSharingClk stopped (see TICKLESS). Only a Task clears it,
+ and tsClockHandler only sets it while the Clock runs, so the two never race.
+ */
+volatile Bool sliceClockStopped = FALSE;
+#endif
+
+#if BACKPRESSURE != BACKPRESSURE_OFF
+/*
+ Backpressure state (see BACKPRESSURE): whether it is on, the watermarks, the callback and the
+ number of times it turned on. backpressureOn only changes through atomicExchange, so of two
+ Tasks crossing the same watermark only one reports the change.
+ */
+volatile Bool backpressureOn = FALSE;
+volatile Int backpressureHigh = BACKPRESSURE_HIGH;
+volatile Int backpressureLow = BACKPRESSURE_LOW;
+volatile BackpressureFxn backpressureFxn = NULL;
+volatile UInt32 backpressureEvents = 0;
+#endif
+
+#if BUFFER_ENGINE == BUFFER_ENGINE_SPSC
+/*
+ SPSC engine state. In this engine "in" is written only by the producerTask and "out" only by
+ the consumerTask, and "count" is not maintained (it would be a shared read-modify-write per
+ item). Each side keeps a private cached copy of the other side's index and only re-reads the
+ shared one when the cached value says the ring is full (producer) or empty (consumer).
+
+ The waiting flags tell the other side that a Task has run out of slots/items and is about to
+ pend on emptySlots/fullSlots - those semaphores are only used in that case.
+ */
+Int spscCachedOut = 0;
+Int spscCachedIn = 0;
+volatile Bool spscProducerWaiting = FALSE;
+volatile Bool spscConsumerWaiting = FALSE;
+#endif
+
+#if BUFFER_ENGINE == BUFFER_ENGINE_MPMC
+/*
+ MPMC engine state. emptySlots/fullSlots still count free/full slots (so a Task never
+ spins on a full/empty buffer - it blocks as before), but there is no mutex: "in"/"out" are
+ the next positions to produce/consume, claimed with atomicCompareExchange, and slotSeq[i]
+ tells which position buffer[i] is ready for:
+
+ 	- slotSeq[i] == position        - the slot is free for the producer of that position;
+ 	- slotSeq[i] == position + 1    - the slot holds the item of that position;
+ 	- slotSeq[i] == position + SIZE - the slot was consumed, free for the next lap.
+
+ "count" is not maintained by this engine (it would serialise all Tasks again).
+ */
+volatile Int slotSeq[BUFFER_SIZE];
+#endif
+
+
+//---------------------------------------------------------------------------
+// main()
+//---------------------------------------------------------------------------
+void main(void)
+{
+	hardware_init();
+#if RNG_SEED == 0
+	rngEntropyInit();
+#endif
+#if BUFFER_ENGINE != BUFFER_ENGINE_SPSC
+	Semaphore_reset(emptySlots, BUFFER_SIZE);
+#endif
+#if BUFFER_ENGINE == BUFFER_ENGINE_MPMC
+	{
+		Int i;
+		for(i = 0; i < BUFFER_SIZE; i++)
+			slotSeq[i] = i;
+	}
+#endif
+#if BUFFER_CHECKED
+	initArray(slotFull, BUFFER_SIZE);
+#endif
+	ledSetMaxBlinkRate(LED_MAX_BLINK_RATE);
+	BIOS_start();
+}
+
+void hardware_init(void)
+{
+	// Disable the Watchdog Timer (important, as this is enabled by default)
+	WDT_A_hold( WDT_A_BASE );
+
+	// Set MCLK frequency to 8192 KHz
+	// First, set DCO FLLREF to 32KHz = REF0
+	UCS_initClockSignal(UCS_FLLREF, UCS_REFOCLK_SELECT, UCS_CLOCK_DIVIDER_1);
+	// Second, Set Ratio and Desired MCLK Frequency = 8192KHz and initialize DCO
+	UCS_initFLLSettle(MCLK_DESIRED_FREQUENCY_IN_KHZ, MCLK_FLLREF_RATIO);
+
+	// Set GPIO ports to low-level outputs
+	GPIO_setAsOutputPin( GPIO_PORT_P1, GPIO_ALL );
+	GPIO_setAsOutputPin( GPIO_PORT_P2, GPIO_ALL );
+	GPIO_setAsOutputPin( GPIO_PORT_P3, GPIO_ALL );
+	GPIO_setAsOutputPin( GPIO_PORT_P4, GPIO_ALL );
+	GPIO_setAsOutputPin( GPIO_PORT_P5, GPIO_ALL );
+	GPIO_setAsOutputPin( GPIO_PORT_P6, GPIO_ALL );
+	GPIO_setAsOutputPin( GPIO_PORT_PJ, GPIO_ALL );
+
+	GPIO_setOutputLowOnPin( GPIO_PORT_P1, GPIO_ALL );
+	GPIO_setOutputLowOnPin( GPIO_PORT_P2, GPIO_ALL );
+	GPIO_setOutputLowOnPin( GPIO_PORT_P3, GPIO_ALL );
+	GPIO_setOutputLowOnPin( GPIO_PORT_P4, GPIO_ALL );
+	GPIO_setOutputLowOnPin( GPIO_PORT_P5, GPIO_ALL );
+	GPIO_setOutputLowOnPin( GPIO_PORT_P6, GPIO_ALL );
+	GPIO_setOutputLowOnPin( GPIO_PORT_PJ, GPIO_ALL );
+}
+
+/*---------------------------------------------------------------------------
+Function name: initArray
+Description: Initialize the buffer's occupancy map.
+Input: volatile UChar *arr, Int size
+Output: None
+Algorithm: mark each buffer slot as empty.
+---------------------------------------------------------------------------*/
+void initArray(volatile UChar *arr, Int size)
+{
+	while(size > 0)
+		arr[--size] = FALSE;
+}
+
+/*---------------------------------------------------------------------------
+Function name: tsClockHandler
+Description: The clock function
+Input: None
+Output: None
+Algorithm: TIME_SLICE_FIXED: yields the current task every 0.5ms to create a
+		   time-sharing mechanism. TIME_SLICE_ADAPTIVE: charges the tick to
+		   the running Task (its ID is in its Env - see taskId), starting a
+		   new quantum when another Task ran since the last tick; once the
+		   quantum is used up, yields if a Task of the same priority is
+		   ready, and otherwise lets it run on, checking again every tick.
+		   Tasks without an ID (the idle Task, which any ready Task preempts
+		   anyway - or none, between Tasks on the host) are left alone;
+		   untracked Tasks always yield. With
+		   TICKLESS, instead of letting the idle Task or a Task without a
+		   ready peer run on, stop timeSharingClk until timeSliceWake.
+---------------------------------------------------------------------------*/
+void tsClockHandler(void)
+{
+#if TIME_SLICE == TIME_SLICE_ADAPTIVE
+	Task_Handle self = Task_self();
+	volatile TimeSlice_T *slice;
+	Int id;
+
+	id = self != NULL ? (Int)(UArg)Task_getEnv(self) : 0;
+	if(id == 0)
+	{
+#if TICKLESS
+		sliceClockStopped = TRUE;
+		Clock_stop(timeSharingClk);
+#endif
+		return;
+	}
+	if(id > STATS_TASKS)
+	{
+		Task_yield();
+		return;
+	}
+	slice = &timeSlice[id - 1];
+	ATOMIC_STORE_RLX(&slice->ticks, slice->ticks + 1);
+	if(id - 1 != sliceRow)
+	{
+		sliceRow = id - 1;
+		sliceUsed = 0;
+	}
+	if(sliceUsed < TIME_SLICE_QUANTUM)
+		sliceUsed++;
+	if(sliceUsed < TIME_SLICE_QUANTUM)
+		return;
+	if(timeSlicePeerReady(self, Task_getPri(self)))
+	{
+		ATOMIC_STORE_RLX(&slice->yields, slice->yields + 1);
+		sliceUsed = 0;
+		Task_yield();
+	}
+	else
+	{
+		ATOMIC_STORE_RLX(&slice->kept, slice->kept + 1);
+#if TICKLESS
+		sliceClockStopped = TRUE;
+		Clock_stop(timeSharingClk);
+#endif
+	}
+#else
+	Task_yield();
+#endif
+}
+
+#if TICKLESS
+/*---------------------------------------------------------------------------
+Function name: timeSliceWake
+Description: Restart the time slicing Clock
+Input: None
+Output: None
+Algorithm: If tsClockHandler stopped timeSharingClk, clear the flag and
+		   start it (first expiry one tick later).
+---------------------------------------------------------------------------*/
+void timeSliceWake(void)
+{
+	if(sliceClockStopped)
+	{
+		sliceClockStopped = FALSE;
+		Clock_start(timeSharingClk);
+	}
+}
+#endif
+
+/*---------------------------------------------------------------------------
+Function name: bufferOccupancy
+Description: Items in the shared buffer
+Input: None
+Output: Int- the number of items.
+Algorithm: Semaphore engine: read "count". SPSC: distance from "out" to
+		   "in". MPMC: distance from "out" to "in", clipped to 0..BUFFER_SIZE
+		   (the two positions are read one after the other).
+---------------------------------------------------------------------------*/
+Int bufferOccupancy(void)
+{
+#if BUFFER_ENGINE == BUFFER_ENGINE_SPSC
+	Int tail = ATOMIC_LOAD_RLX(&out);
+	Int head = ATOMIC_LOAD_RLX(&in);
+	return SPSC_USED(head, tail);
+#elif BUFFER_ENGINE == BUFFER_ENGINE_MPMC
+	Int tail = ATOMIC_LOAD_RLX(&out);
+	Int head = ATOMIC_LOAD_RLX(&in);
+	Int used = MPMC_DIFF(head, tail);
+	return used < 0 ? 0 : used > BUFFER_SIZE ? BUFFER_SIZE : used;
+#else
+	return ATOMIC_LOAD_RLX(&count);
+#endif
+}
+
+#if BACKPRESSURE != BACKPRESSURE_OFF
+/*---------------------------------------------------------------------------
+Function name: backpressureUpdate
+Description: Turn backpressure on/off by the watermarks
+Input: None
+Output: None
+Algorithm: At or above the high watermark, set backpressureOn; at or below
+		   the low one, clear it. Only the Task whose atomicExchange actually
+		   changed it counts, traces and reports the change to the callback.
+---------------------------------------------------------------------------*/
+void backpressureUpdate(void)
+{
+	Int occupancy = bufferOccupancy();
+	BackpressureFxn fxn;
+	Bool on;
+
+	if(occupancy >= backpressureHigh)
+	{
+		if(ATOMIC_LOAD_RLX(&backpressureOn) || atomicExchange(&backpressureOn, TRUE))
+			return;
+		on = TRUE;
+		ATOMIC_STORE_RLX(&backpressureEvents, backpressureEvents + 1);
+		TRACE_INFO(BACKPRESSURE_ON, occupancy, backpressureHigh);
+	}
+	else if(occupancy <= backpressureLow)
+	{
+		if(!ATOMIC_LOAD_RLX(&backpressureOn) || !atomicExchange(&backpressureOn, FALSE))
+			return;
+		on = FALSE;
+		TRACE_INFO(BACKPRESSURE_OFF, occupancy, backpressureLow);
+	}
+	else
+		return;
+	fxn = backpressureFxn;
+	if(fxn != NULL)
+		fxn(on, occupancy);
+}
+
+/*---------------------------------------------------------------------------
+Function name: backpressureAdmit
+Description: Producer side of backpressure
+Input: volatile StatsRow_T *row, Int items
+Output: Bool- False if the items are to be dropped.
+Algorithm: BACKPRESSURE_THROTTLE: sleep BACKPRESSURE_THROTTLE_TICKS at a
+		   time until backpressure is off. BACKPRESSURE_SHED: refuse the
+		   items while it is on, after one such sleep so that the producer
+		   does not spin. Count the sleeps/items in the Task's row.
+---------------------------------------------------------------------------*/
+Bool backpressureAdmit(volatile StatsRow_T *row, Int items)
+{
+#if BACKPRESSURE == BACKPRESSURE_THROTTLE
+	while(ATOMIC_LOAD_RLX(&backpressureOn))
+	{
+		statsAdd(row, &row->counts.throttled, 1);
+		Task_sleep(BACKPRESSURE_THROTTLE_TICKS);
+	}
+#elif BACKPRESSURE == BACKPRESSURE_SHED
+	if(ATOMIC_LOAD_RLX(&backpressureOn))
+	{
+		statsAdd(row, &row->counts.shed, items);
+		Task_sleep(BACKPRESSURE_THROTTLE_TICKS);
+		return FALSE;
+	}
+#endif
+	return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+Function name: backpressureSetCallback
+Description: Set the backpressure callback
+Input: BackpressureFxn fxn
+Output: BackpressureFxn- the old callback.
+Algorithm: Swap backpressureFxn (a single pointer store).
+---------------------------------------------------------------------------*/
+BackpressureFxn backpressureSetCallback(BackpressureFxn fxn)
+{
+	BackpressureFxn old = backpressureFxn;
+
+	backpressureFxn = fxn;
+	return old;
+}
+
+/*---------------------------------------------------------------------------
+Function name: backpressureSetWatermarks
+Description: Set the backpressure watermarks
+Input: Int high, Int low
+Output: Bool- False if the watermarks are out of range.
+Algorithm: Check 0 <= low < high <= BUFFER_SIZE and store both. The next
+		   insert/remove compares with the new ones.
+---------------------------------------------------------------------------*/
+Bool backpressureSetWatermarks(Int high, Int low)
+{
+	if(low < 0 || low >= high || high > BUFFER_SIZE)
+		return FALSE;
+	backpressureHigh = high;
+	backpressureLow = low;
+	return TRUE;
+}
+#endif
+
+/*---------------------------------------------------------------------------
+Function name: consumerSetPriority
+Description: Put a consumer in its priority class
+Input: UArg consumerId
+Output: None
+Algorithm: Look the consumer's priority up in CONSUMER_PRIORITIES (the last
+		   entry repeats) and, unless it is 0, Task_setPri the running Task.
+---------------------------------------------------------------------------*/
+void consumerSetPriority(UArg consumerId)
+{
+	static const Int priorities[] = { CONSUMER_PRIORITIES };
+	Int index = (Int)consumerId - 1;
+
+	if(index >= (Int)(sizeof(priorities) / sizeof(priorities[0])))
+		index = sizeof(priorities) / sizeof(priorities[0]) - 1;
+	if(index < 0)
+		index = 0;
+	if(priorities[index] > 0)
+		Task_setPri(Task_self(), priorities[index]);
+}
+
+/*---------------------------------------------------------------------------
+Function name: producerHandler
+Description: The producers task.
+Input: UArg arg0, UArg arg1
+Output: None
+Algorithm: Activates insert_item function to insert an item to the buffer,
+		   if succeeded- print a log message, update his ledBlinkInfo and
+		   send it to prepForLedSrv function. With PRODUCER_BATCH_SIZE > 1, a
+		   whole batch of items is generated and inserted with insert_items.
+		   Items, errors and LED requests are counted in the Task's statsRows
+		   row. With BACKPRESSURE, new items first go through
+		   backpressureAdmit and every insert updates the backpressure state.
+		   With INSERT_TIMEOUT_TICKS, an item which cannot be inserted in
+		   time is dropped.
+---------------------------------------------------------------------------*/
+void producerHandler(UArg arg0, UArg arg1)
+{
+#if LED_SERVICE
+	LedBlinksInfo_T ledBlinkInfo;
+#endif
+	Int prodItem;
+	Workload_T workload;
+	volatile StatsRow_T *stats;
+#if INSERT_TIMEOUT_TICKS > 0
+	BufferStatus_E status;
+#endif
+#if PRODUCER_BATCH_SIZE > 1
+	BufferItem_T prodItems[PRODUCER_BATCH_SIZE];
+	Int i, done, inserted;
+#endif
+	workloadInit(&workload, arg0);
+#if BUFFER_ENGINE == BUFFER_ENGINE_SPSC
+	if(arg0 != 1)
+	{
+		TRACE_ERROR(PRODUCER_SPSC_ERROR, arg0, 0);
+		return;
+	}
+#endif
+	stats = statsRegister();
+	while(TRUE)
+	{
+#if PRODUCER_BATCH_SIZE > 1
+		for(i = 0; i < PRODUCER_BATCH_SIZE; i++)
+			prodItems[i] = ITEM_MAKE(workloadNext(&workload));
+#if BACKPRESSURE != BACKPRESSURE_OFF
+		if(!backpressureAdmit(stats, PRODUCER_BATCH_SIZE))
+			continue;
+#endif
+		for(done = 0; done < PRODUCER_BATCH_SIZE; done += inserted)
+		{
+			inserted = insert_items(prodItems + done, PRODUCER_BATCH_SIZE - done);
+			if(inserted == 0)
+			{
+				statsAdd(stats, &stats->counts.insertErrors, 1);
+				TRACE_ERROR(PRODUCER_ERROR, arg0, 0);
+				break;
+			}
+			statsAdd(stats, &stats->counts.produced, inserted);
+#if BACKPRESSURE != BACKPRESSURE_OFF
+			backpressureUpdate();
+#endif
+			for(i = done; i < done + inserted; i++)
+			{
+				prodItem = ITEM_VALUE(prodItems[i]);
+				TRACE_DEBUG(PRODUCER_ITEM, arg0, prodItem);
+#if LED_SERVICE
+				ledBlinkInfo.led = green_e;
+				ledBlinkInfo.blinksNum = prodItem;
+				prepForLedSrv(&ledBlinkInfo);
+				statsAdd(stats, &stats->counts.ledPosted, 1);
+#endif
+			}
+		}
+#else
+		prodItem = workloadNext(&workload);
+#if BACKPRESSURE != BACKPRESSURE_OFF
+		if(!backpressureAdmit(stats, 1))
+			continue;
+#endif
+#if INSERT_TIMEOUT_TICKS > 0
+		status = insert_item_timeout(ITEM_MAKE(prodItem), INSERT_TIMEOUT_TICKS);
+		if(status == buffer_timeout_e)
+		{
+			TRACE_INFO(PRODUCER_TIMEOUT, arg0, prodItem);
+			continue;
+		}
+		if(status != buffer_ok_e)
+#else
+		if(!insert_item(ITEM_MAKE(prodItem)))
+#endif
+		{
+			statsAdd(stats, &stats->counts.insertErrors, 1);
+			TRACE_ERROR(PRODUCER_ERROR, arg0, 0);
+			continue;
+		}
+		statsAdd(stats, &stats->counts.produced, 1);
+#if BACKPRESSURE != BACKPRESSURE_OFF
+		backpressureUpdate();
+#endif
+		TRACE_DEBUG(PRODUCER_ITEM, arg0, prodItem);
+#if LED_SERVICE
+		ledBlinkInfo.led = green_e;
+		ledBlinkInfo.blinksNum = prodItem;
+		prepForLedSrv(&ledBlinkInfo);
+		statsAdd(stats, &stats->counts.ledPosted, 1);
+#endif
+#endif
+	}
+}
+
+/*---------------------------------------------------------------------------
+Function name: consumerHandler
+Description: The consumers task.
+Input: UArg arg0, UArg arg1
+Output: None
+Algorithm: Activates remove_item function to remove an item from the buffer,
+		   if succeeded- print a log message, update his ledBlinkInfo and
+		   send it to prepForLedSrv function. With CONSUMER_BATCH_SIZE > 1, up
+		   to a whole batch of items is removed at once with remove_items.
+		   Items, errors and LED requests are counted in the Task's statsRows
+		   row. The Task first takes its CONSUMER_PRIORITIES priority, and
+		   with BACKPRESSURE every remove updates the backpressure state.
+		   With REMOVE_TIMEOUT_TICKS, a remove which times out is retried.
+---------------------------------------------------------------------------*/
+void consumerHandler(UArg arg0, UArg arg1)
+{
+#if LED_SERVICE
+	LedBlinksInfo_T ledBlinkInfo;
+#endif
+	BufferItem_T consItem;
+	volatile StatsRow_T *stats;
+#if REMOVE_TIMEOUT_TICKS > 0
+	BufferStatus_E status;
+#endif
+#if CONSUMER_BATCH_SIZE > 1
+	BufferItem_T consItems[CONSUMER_BATCH_SIZE];
+	Int i, removed;
+#endif
+#if LATENCY_STATS && LATENCY_DUMP_EVERY > 0
+	UInt32 sinceDump = 0;
+#endif
+#if STACK_DUMP_EVERY > 0
+	UInt32 sinceStackDump = 0;
+#endif
+#if SERVICE != SERVICE_NONE
+	Service_T service;
+	serviceInit(&service, arg0);
+#endif
+#if BUFFER_ENGINE == BUFFER_ENGINE_SPSC
+	if(arg0 != 1)
+	{
+		TRACE_ERROR(CONSUMER_SPSC_ERROR, arg0, 0);
+		return;
+	}
+#endif
+	consumerSetPriority(arg0);
+	stats = statsRegister();
+	while(TRUE)
+	{
+#if CONSUMER_BATCH_SIZE > 1
+		removed = remove_items(consItems, CONSUMER_BATCH_SIZE);
+		if(removed == 0)
+		{
+			statsAdd(stats, &stats->counts.removeErrors, 1);
+			TRACE_ERROR(CONSUMER_ERROR, arg0, 0);
+			continue;
+		}
+		statsAdd(stats, &stats->counts.consumed, removed);
+#if BACKPRESSURE != BACKPRESSURE_OFF
+		backpressureUpdate();
+#endif
+		for(i = 0; i < removed; i++)
+		{
+			consItem = consItems[i];
+			TRACE_DEBUG(CONSUMER_ITEM, arg0, ITEM_VALUE(consItem));
+#if SERVICE != SERVICE_NONE
+			serviceItem(&service, ITEM_VALUE(consItem));
+#endif
+#if LED_SERVICE
+			ledBlinkInfo.led = red_e;
+			ledBlinkInfo.blinksNum = ITEM_VALUE(consItem);
+			prepForLedSrv(&ledBlinkInfo);
+			statsAdd(stats, &stats->counts.ledPosted, 1);
+#endif
+		}
+#else
+#if REMOVE_TIMEOUT_TICKS > 0
+		status = remove_item_timeout(&consItem, REMOVE_TIMEOUT_TICKS);
+		if(status == buffer_timeout_e)
+		{
+			TRACE_INFO(CONSUMER_TIMEOUT, arg0, 0);
+			continue;
+		}
+		if(status != buffer_ok_e)
+#else
+		if(!remove_item(&consItem))
+#endif
+		{
+			statsAdd(stats, &stats->counts.removeErrors, 1);
+			TRACE_ERROR(CONSUMER_ERROR, arg0, 0);
+			continue;
+		}
+		statsAdd(stats, &stats->counts.consumed, 1);
+#if BACKPRESSURE != BACKPRESSURE_OFF
+		backpressureUpdate();
+#endif
+		TRACE_DEBUG(CONSUMER_ITEM, arg0, ITEM_VALUE(consItem));
+#if SERVICE != SERVICE_NONE
+		serviceItem(&service, ITEM_VALUE(consItem));
+#endif
+#if LED_SERVICE
+		ledBlinkInfo.led = red_e;
+		ledBlinkInfo.blinksNum = ITEM_VALUE(consItem);
+		prepForLedSrv(&ledBlinkInfo);
+		statsAdd(stats, &stats->counts.ledPosted, 1);
+#endif
+#endif
+#if LATENCY_STATS && LATENCY_DUMP_EVERY > 0
+#if CONSUMER_BATCH_SIZE > 1
+		sinceDump += removed;
+#else
+		sinceDump++;
+#endif
+		if(arg0 == 1 && sinceDump >= LATENCY_DUMP_EVERY)
+		{
+			latencyDump();
+			sinceDump = 0;
+		}
+#endif
+#if STACK_DUMP_EVERY > 0
+		if(arg0 == 1 && ++sinceStackDump >= STACK_DUMP_EVERY)
+		{
+			stackDump();
+			sinceStackDump = 0;
+		}
+#endif
+	}
+}
+
+/*---------------------------------------------------------------------------
+Function name: prepForLedSrv
+Description: Post a request to the LED service
+Input: const LedBlinksInfo_T* ledBlinkInfo
+Output: None
+Algorithm: Under setLedEnvMutex: with LED_POLICY_COALESCE, merge the
+		   request into a queued request for the same LED, if there is one.
+		   Otherwise copy it to the end of the LED request queue - if the
+		   queue is full, drop the request or (LED_POLICY_DROP_OLDEST) the
+		   oldest one. Then post ledSrvSchedSem (after releasing the mutex,
+		   since ledSrvTask will preempt us right away).
+---------------------------------------------------------------------------*/
+void prepForLedSrv(const LedBlinksInfo_T* ledBlinkInfo)
+{
+#if LED_QUEUE_POLICY == LED_POLICY_COALESCE
+	Int i, idx;
+#endif
+	SEM_PEND(setLedEnvMutex, BIOS_WAIT_FOREVER);
+#if LED_QUEUE_POLICY == LED_POLICY_COALESCE
+	idx = ledQueueHead;
+	for(i = 0; i < ledQueueCount; i++)
+	{
+		if(ledQueue[idx].led == ledBlinkInfo->led)
+		{
+#if LED_COALESCE_MODE == LED_COALESCE_SUM
+			ledQueue[idx].blinksNum += ledBlinkInfo->blinksNum;
+			if(ledQueue[idx].blinksNum > LED_MAX_BLINKS)
+				ledQueue[idx].blinksNum = LED_MAX_BLINKS;
+#else
+			ledQueue[idx].blinksNum = ledBlinkInfo->blinksNum;
+#endif
+			ledRequestsCoalesced++;
+			SEM_POST(setLedEnvMutex);
+			return;							//ledSrvSchedSem was posted with the queued request
+		}
+		idx = (idx + 1 == LED_QUEUE_SIZE) ? 0 : idx + 1;
+	}
+#endif
+	if(ledQueueCount == LED_QUEUE_SIZE)
+	{
+#if LED_QUEUE_POLICY == LED_POLICY_DROP_OLDEST
+		TRACE_INFO(LED_DROPPED, ledQueue[ledQueueHead].led, ledQueue[ledQueueHead].blinksNum);
+		ledQueueHead = (ledQueueHead + 1 == LED_QUEUE_SIZE) ? 0 : ledQueueHead + 1;
+		ledQueueCount--;
+		ledRequestsDropped++;
+#else
+		TRACE_INFO(LED_DROPPED, ledBlinkInfo->led, ledBlinkInfo->blinksNum);
+		ledRequestsDropped++;
+		SEM_POST(setLedEnvMutex);
+		return;
+#endif
+	}
+	{
+		Int tail = ledQueueHead + ledQueueCount;
+		if(tail >= LED_QUEUE_SIZE)
+			tail -= LED_QUEUE_SIZE;
+		ledQueue[tail] = *ledBlinkInfo;
+		ledQueueCount++;
+	}
+	SEM_POST(setLedEnvMutex);
+	SEM_POST(ledSrvSchedSem);
+}
+
+/*---------------------------------------------------------------------------
+Function name: ledQueueGet
+Description: Take a request out of the LED request queue
 Input: LedBlinksInfo_T* ledBlinkInfo
+Output: Bool- True if a request was taken, False if the queue is empty.
+Algorithm: Under setLedEnvMutex, copy the oldest request and advance the
+		   queue head.
+---------------------------------------------------------------------------*/
+Bool ledQueueGet(LedBlinksInfo_T* ledBlinkInfo)
+{
+	Bool found = FALSE;
+	SEM_PEND(setLedEnvMutex, BIOS_WAIT_FOREVER);
+	if(ledQueueCount > 0)
+	{
+		*ledBlinkInfo = ledQueue[ledQueueHead];
+		ledQueueHead = (ledQueueHead + 1 == LED_QUEUE_SIZE) ? 0 : ledQueueHead + 1;
+		ledQueueCount--;
+		found = TRUE;
+	}
+	SEM_POST(setLedEnvMutex);
+	return found;
+}
+
+/*---------------------------------------------------------------------------
+Function name: ledSrvTaskHandler
+Description: LEDs manager
+Input: None
+Output: None
+Algorithm: Wait until a producer/consumer need his service, then take the
+		   queued requests one by one, start blinking the needed LED and wait
+		   for ledBlinkClk to finish the pattern (counted as served).
+---------------------------------------------------------------------------*/
+void ledSrvTaskHandler(void)
+{
+	LedBlinksInfo_T ledBlinkInfo;
+	volatile StatsRow_T *stats = statsRegister();
+	while(TRUE)
+	{
+		SEM_PEND(ledSrvSchedSem, BIOS_WAIT_FOREVER);
+		while(ledQueueGet(&ledBlinkInfo))
+		{
+			TRACE_DEBUG(LED_BLINK, ledBlinkInfo.led, ledBlinkInfo.blinksNum);
+			if(ledBlinkInfo.led == green_e)
+				ledToggle(GREEN, ledBlinkInfo.blinksNum);
+			else
+				ledToggle(RED, ledBlinkInfo.blinksNum);
+			SEM_PEND(ledBlinkDoneSem, BIOS_WAIT_FOREVER);
+			statsAdd(stats, &stats->counts.ledServed, 1);
+		}
+	}
+}
+
+#if BUFFER_ENGINE == BUFFER_ENGINE_SEMAPHORE
+/*---------------------------------------------------------------------------
+Function name: insert_item_timeout
+Description: Inserts an item to the buffer, waiting until a deadline at most
+Input: BufferItem_T item, UInt32 timeout
+Output: BufferStatus_E- buffer_ok_e if an item was inserted, buffer_error_e
+		if not, buffer_timeout_e if the deadline passed first.
+Algorithm: Wait until there is empty space in the buffer, then check if the next
+		   place is empty, if it is- it inserts the item, increase count,
+		   advance "in" variable and issue a log message, then signals the
+		   consumers. The pends share the deadline: a timeout on the mutex
+		   gives the empty slot back.
+---------------------------------------------------------------------------*/
+BufferStatus_E insert_item_timeout(BufferItem_T item, UInt32 timeout)
+{
+	UInt32 start = deadlineStart(timeout);
+
+	if(!SEM_PEND(emptySlots, timeout))
+		return deadlineAccount(buffer_timeout_e, start, timeout);
+	if(!SEM_PEND(mutex, deadlineLeft(start, timeout)))
+	{
+		SEM_POST(emptySlots);
+		return deadlineAccount(buffer_timeout_e, start, timeout);
+	}
+	if(SLOT_IS_FULL(in))
+	{
+		TRACE_ERROR(INSERT_ERROR, ITEM_VALUE(item), 0);
+		SEM_POST(mutex);
+		SEM_POST(emptySlots);
+		return buffer_error_e;
+	}
+	count = -~count;
+	buffer[in] = item;
+	SLOT_SET_FULL(in);
+	SLOT_STAMP(in);
+	in = BUFFER_NEXT(in);
+	TRACE_DEBUG(PRODUCED, ITEM_VALUE(item), count);
+	SEM_POST(mutex);
+	SEM_POST(fullSlots);
+	return deadlineAccount(buffer_ok_e, start, timeout);
+}
+
+/*---------------------------------------------------------------------------
+Function name: remove_item_timeout
+Description: Removes an item from the buffer, waiting until a deadline at most
+Input: BufferItem_T *item, UInt32 timeout
+Output: BufferStatus_E- buffer_ok_e if an item was removed, buffer_error_e
+		if not, buffer_timeout_e if the deadline passed first.
+Algorithm: Wait until there are items in the buffer, then check if the next
+		   place is not empty, if it's not- it removes the item, reduce count,
+		   advance "out" variable and issue a log message, then signals the
+		   producers. The pends share the deadline: a timeout on the mutex
+		   gives the item back.
+---------------------------------------------------------------------------*/
+BufferStatus_E remove_item_timeout(BufferItem_T *item, UInt32 timeout)
+{
+	UInt32 start = deadlineStart(timeout);
+
+	if(!SEM_PEND(fullSlots, timeout))
+		return deadlineAccount(buffer_timeout_e, start, timeout);
+	if(!SEM_PEND(mutex, deadlineLeft(start, timeout)))
+	{
+		SEM_POST(fullSlots);
+		return deadlineAccount(buffer_timeout_e, start, timeout);
+	}
+	if(SLOT_IS_EMPTY(out))
+	{
+		TRACE_ERROR(REMOVE_ERROR, 0, 0);
+		SEM_POST(mutex);
+		SEM_POST(fullSlots);
+		return buffer_error_e;
+	}
+	count--;
+	*item = buffer[out];
+	SLOT_LATENCY(out);
+	SLOT_SET_EMPTY(out);
+	out = BUFFER_NEXT(out);
+	TRACE_DEBUG(CONSUMED, ITEM_VALUE(*item), count);
+	SEM_POST(mutex);
+	SEM_POST(emptySlots);
+	return deadlineAccount(buffer_ok_e, start, timeout);
+}
+
+/*---------------------------------------------------------------------------
+Function name: insert_items
+Description: Inserts up to n items to the buffer in one critical section
+Input: const BufferItem_T *items, Int n
+Output: Int- number of items inserted (0 on abnormal behaviour).
+Algorithm: Wait until there is at least one empty slot and take up to n-1
+		   more without waiting (pendUpTo). Then, under one hold of the mutex,
+		   insert the items one after the other as insert_item does, stopping
+		   at the first slot which is not empty. Give back the slots that were
+		   not used and signal the consumers once per inserted item.
+---------------------------------------------------------------------------*/
+Int insert_items(const BufferItem_T *items, Int n)
+{
+	Int claimed = pendUpTo(emptySlots, n);
+	Int i;
+	SEM_PEND(mutex, BIOS_WAIT_FOREVER);
+	for(i = 0; i < claimed; i++)
+	{
+		if(SLOT_IS_FULL(in))
+		{
+			TRACE_ERROR(INSERT_ITEMS_ERROR, ITEM_VALUE(items[i]), 0);
+			break;
+		}
+		count = -~count;
+		buffer[in] = items[i];
+		SLOT_SET_FULL(in);
+		SLOT_STAMP(in);
+		in = BUFFER_NEXT(in);
+		TRACE_DEBUG(PRODUCED, ITEM_VALUE(items[i]), count);
+	}
+	SEM_POST(mutex);
+	postN(emptySlots, claimed - i);
+	postN(fullSlots, i);
+	return i;
+}
+
+/*---------------------------------------------------------------------------
+Function name: remove_items
+Description: Removes up to max items from the buffer in one critical section
+Input: BufferItem_T *items, Int max
+Output: Int- number of items removed (0 on abnormal behaviour).
+Algorithm: Wait until there is at least one full slot and take up to max-1
+		   more without waiting (pendUpTo). Then, under one hold of the mutex,
+		   remove the items one after the other as remove_item does, stopping
+		   at the first slot which is empty. Give back the full slots that were
+		   not used and signal the producers once per removed item.
+---------------------------------------------------------------------------*/
+Int remove_items(BufferItem_T *items, Int max)
+{
+	Int claimed = pendUpTo(fullSlots, max);
+	Int i;
+	SEM_PEND(mutex, BIOS_WAIT_FOREVER);
+	for(i = 0; i < claimed; i++)
+	{
+		if(SLOT_IS_EMPTY(out))
+		{
+			TRACE_ERROR(REMOVE_ITEMS_ERROR, out, 0);
+			break;
+		}
+		count--;
+		items[i] = buffer[out];
+		SLOT_LATENCY(out);
+		SLOT_SET_EMPTY(out);
+		out = BUFFER_NEXT(out);
+		TRACE_DEBUG(CONSUMED, ITEM_VALUE(items[i]), count);
+	}
+	SEM_POST(mutex);
+	postN(fullSlots, claimed - i);
+	postN(emptySlots, i);
+	return i;
+}
+
+#elif BUFFER_ENGINE == BUFFER_ENGINE_SPSC
+/*---------------------------------------------------------------------------
+Function name: spscWaitForRoom
+Description: Producer side of the SPSC ring - how many slots are free
+Input: Int head (the producer's "in"), Int wanted, UInt32 timeout
+Output: Int- number of free slots (0 only if the timeout expired).
+Algorithm: Use the cached copy of "out", re-reading the shared one only when
+		   the cache shows less than "wanted" free slots. If the ring really is
+		   full, raise spscProducerWaiting and pend on emptySlots until the
+		   consumer frees a slot or the timeout expires. A post which comes
+		   after the timeout stays in emptySlots - the next wait takes it,
+		   finds no room and pends again.
+---------------------------------------------------------------------------*/
+Int spscWaitForRoom(Int head, Int wanted, UInt32 timeout)
+{
+	Int room = BUFFER_SIZE - SPSC_USED(head, spscCachedOut);
+	UInt32 start;
+	if(room < wanted)
+	{
+		spscCachedOut = ATOMIC_LOAD_ACQ(&out);
+		room = BUFFER_SIZE - SPSC_USED(head, spscCachedOut);
+		start = deadlineStart(timeout);
+		while(room == 0)
+		{
+			ATOMIC_STORE_RLX(&spscProducerWaiting, TRUE);
+			ATOMIC_FENCE();
+			spscCachedOut = ATOMIC_LOAD_ACQ(&out);
+			room = BUFFER_SIZE - SPSC_USED(head, spscCachedOut);
+			if(room != 0)
+				break;
+			if(!SEM_PEND(emptySlots, deadlineLeft(start, timeout)))
+			{
+				spscCachedOut = ATOMIC_LOAD_ACQ(&out);
+				room = BUFFER_SIZE - SPSC_USED(head, spscCachedOut);
+				break;
+			}
+			spscCachedOut = ATOMIC_LOAD_ACQ(&out);
+			room = BUFFER_SIZE - SPSC_USED(head, spscCachedOut);
+		}
+		ATOMIC_STORE_RLX(&spscProducerWaiting, FALSE);
+	}
+	return room;
+}
+
+/*---------------------------------------------------------------------------
+Function name: spscWaitForItems
+Description: Consumer side of the SPSC ring - how many items are available
+Input: Int tail (the consumer's "out"), Int wanted, UInt32 timeout
+Output: Int- number of available items (0 only if the timeout expired).
+Algorithm: Mirror image of spscWaitForRoom, using the cached copy of "in",
+		   spscConsumerWaiting and fullSlots.
+---------------------------------------------------------------------------*/
+Int spscWaitForItems(Int tail, Int wanted, UInt32 timeout)
+{
+	Int avail = SPSC_USED(spscCachedIn, tail);
+	UInt32 start;
+	if(avail < wanted)
+	{
+		spscCachedIn = ATOMIC_LOAD_ACQ(&in);
+		avail = SPSC_USED(spscCachedIn, tail);
+		start = deadlineStart(timeout);
+		while(avail == 0)
+		{
+			ATOMIC_STORE_RLX(&spscConsumerWaiting, TRUE);
+			ATOMIC_FENCE();
+			spscCachedIn = ATOMIC_LOAD_ACQ(&in);
+			avail = SPSC_USED(spscCachedIn, tail);
+			if(avail != 0)
+				break;
+			if(!SEM_PEND(fullSlots, deadlineLeft(start, timeout)))
+			{
+				spscCachedIn = ATOMIC_LOAD_ACQ(&in);
+				avail = SPSC_USED(spscCachedIn, tail);
+				break;
+			}
+			spscCachedIn = ATOMIC_LOAD_ACQ(&in);
+			avail = SPSC_USED(spscCachedIn, tail);
+		}
+		ATOMIC_STORE_RLX(&spscConsumerWaiting, FALSE);
+	}
+	return avail;
+}
+
+/*---------------------------------------------------------------------------
+Function name: spscPublishIn
+Description: Publish produced items to the consumer
+Input: Int head (the new "in")
+Output: None
+Algorithm: Release-store "in", then post fullSlots if the consumer is waiting.
+---------------------------------------------------------------------------*/
+void spscPublishIn(Int head)
+{
+	ATOMIC_STORE_REL(&in, head);
+	ATOMIC_FENCE();
+	if(ATOMIC_LOAD_RLX(&spscConsumerWaiting) && atomicExchange(&spscConsumerWaiting, FALSE))
+		SEM_POST(fullSlots);
+}
+
+/*---------------------------------------------------------------------------
+Function name: spscPublishOut
+Description: Publish freed slots to the producer
+Input: Int tail (the new "out")
+Output: None
+Algorithm: Release-store "out", then post emptySlots if the producer is waiting.
+---------------------------------------------------------------------------*/
+void spscPublishOut(Int tail)
+{
+	ATOMIC_STORE_REL(&out, tail);
+	ATOMIC_FENCE();
+	if(ATOMIC_LOAD_RLX(&spscProducerWaiting) && atomicExchange(&spscProducerWaiting, FALSE))
+		SEM_POST(emptySlots);
+}
+
+/*---------------------------------------------------------------------------
+Function name: insert_item_timeout (SPSC engine)
+Description: Inserts an item to the ring, without semaphores while there is room
+Input: BufferItem_T item, UInt32 timeout
+Output: BufferStatus_E- buffer_ok_e if an item was inserted, buffer_error_e
+		if not, buffer_timeout_e if the deadline passed first.
+Algorithm: Wait for a free slot (spscWaitForRoom), check the slot is empty,
+		   store the item and publish the new "in".
+---------------------------------------------------------------------------*/
+BufferStatus_E insert_item_timeout(BufferItem_T item, UInt32 timeout)
+{
+	Int head = in;
+	Int slot = SPSC_SLOT(head);
+	UInt32 start = deadlineStart(timeout);
+
+	if(spscWaitForRoom(head, 1, timeout) == 0)
+		return deadlineAccount(buffer_timeout_e, start, timeout);
+	if(SLOT_IS_FULL(slot))
+	{
+		TRACE_ERROR(INSERT_ERROR, ITEM_VALUE(item), 0);
+		return buffer_error_e;
+	}
+	buffer[slot] = item;
+	SLOT_SET_FULL(slot);
+	SLOT_STAMP(slot);
+	head = SPSC_NEXT(head);
+	spscPublishIn(head);
+	TRACE_DEBUG(PRODUCED, ITEM_VALUE(item), SPSC_USED(head, spscCachedOut));
+	return deadlineAccount(buffer_ok_e, start, timeout);
+}
+
+/*---------------------------------------------------------------------------
+Function name: remove_item_timeout (SPSC engine)
+Description: Removes an item from the ring, without semaphores while there are items
+Input: BufferItem_T *item, UInt32 timeout
+Output: BufferStatus_E- buffer_ok_e if an item was removed, buffer_error_e
+		if not, buffer_timeout_e if the deadline passed first.
+Algorithm: Wait for an item (spscWaitForItems), check the slot is not empty,
+		   take the item, mark the slot empty and publish the new "out".
+---------------------------------------------------------------------------*/
+BufferStatus_E remove_item_timeout(BufferItem_T *item, UInt32 timeout)
+{
+	Int tail = out;
+	Int slot = SPSC_SLOT(tail);
+	UInt32 start = deadlineStart(timeout);
+
+	if(spscWaitForItems(tail, 1, timeout) == 0)
+		return deadlineAccount(buffer_timeout_e, start, timeout);
+	if(SLOT_IS_EMPTY(slot))
+	{
+		TRACE_ERROR(REMOVE_ERROR, 0, 0);
+		return buffer_error_e;
+	}
+	*item = buffer[slot];
+	SLOT_LATENCY(slot);
+	SLOT_SET_EMPTY(slot);
+	tail = SPSC_NEXT(tail);
+	spscPublishOut(tail);
+	TRACE_DEBUG(CONSUMED, ITEM_VALUE(*item), SPSC_USED(spscCachedIn, tail));
+	return deadlineAccount(buffer_ok_e, start, timeout);
+}
+
+/*---------------------------------------------------------------------------
+Function name: insert_items (SPSC engine)
+Description: Inserts up to n items to the ring with a single publish
+Input: const BufferItem_T *items, Int n
+Output: Int- number of items inserted (0 on abnormal behaviour).
+Algorithm: Wait until at least one slot is free, then copy as many of the
+		   items as there is room for and publish them all with one store of
+		   "in" (and at most one post of fullSlots).
+---------------------------------------------------------------------------*/
+Int insert_items(const BufferItem_T *items, Int n)
+{
+	Int head = in;
+	Int room = spscWaitForRoom(head, n, BIOS_WAIT_FOREVER);
+	Int i, slot;
+	if(n > room)
+		n = room;
+	for(i = 0; i < n; i++)
+	{
+		slot = SPSC_SLOT(head);
+		if(SLOT_IS_FULL(slot))
+		{
+			TRACE_ERROR(INSERT_ITEMS_ERROR, ITEM_VALUE(items[i]), 0);
+			break;
+		}
+		buffer[slot] = items[i];
+		SLOT_SET_FULL(slot);
+		SLOT_STAMP(slot);
+		head = SPSC_NEXT(head);
+		TRACE_DEBUG(PRODUCED, ITEM_VALUE(items[i]), SPSC_USED(head, spscCachedOut));
+	}
+	if(i > 0)
+	{
+		spscPublishIn(head);
+	}
+	return i;
+}
+
+/*---------------------------------------------------------------------------
+Function name: remove_items (SPSC engine)
+Description: Removes up to max items from the ring with a single publish
+Input: BufferItem_T *items, Int max
+Output: Int- number of items removed (0 on abnormal behaviour).
+Algorithm: Wait until at least one item is available, then take as many as
+		   are available (up to max) and free them all with one store of "out"
+		   (and at most one post of emptySlots).
+---------------------------------------------------------------------------*/
+Int remove_items(BufferItem_T *items, Int max)
+{
+	Int tail = out;
+	Int avail = spscWaitForItems(tail, max, BIOS_WAIT_FOREVER);
+	Int i, slot;
+	if(max > avail)
+		max = avail;
+	for(i = 0; i < max; i++)
+	{
+		slot = SPSC_SLOT(tail);
+		if(SLOT_IS_EMPTY(slot))
+		{
+			TRACE_ERROR(REMOVE_ITEMS_ERROR, slot, 0);
+			break;
+		}
+		items[i] = buffer[slot];
+		SLOT_LATENCY(slot);
+		SLOT_SET_EMPTY(slot);
+		tail = SPSC_NEXT(tail);
+		TRACE_DEBUG(CONSUMED, ITEM_VALUE(items[i]), SPSC_USED(spscCachedIn, tail));
+	}
+	if(i > 0)
+	{
+		spscPublishOut(tail);
+	}
+	return i;
+}
+
+#elif BUFFER_ENGINE == BUFFER_ENGINE_MPMC
+/*---------------------------------------------------------------------------
+Function name: insert_item_timeout (MPMC engine)
+Description: Inserts an item to the buffer without taking the mutex
+Input: BufferItem_T item, UInt32 timeout
+Output: BufferStatus_E- buffer_ok_e if an item was inserted, buffer_error_e
+		if not, buffer_timeout_e if the deadline passed first.
+Algorithm: Wait on emptySlots as usual (until the deadline at most). Then
+		   claim position "in" with a compare-and-swap, once the slot of that
+		   position is free (its sequence equals the position). Check the slot
+		   is empty, store the item and publish it by advancing the slot's
+		   sequence, then signal the consumers.
+---------------------------------------------------------------------------*/
+BufferStatus_E insert_item_timeout(BufferItem_T item, UInt32 timeout)
+{
+	Int pos, slot, diff;
+	UInt32 start = deadlineStart(timeout);
+
+	if(!SEM_PEND(emptySlots, timeout))
+		return deadlineAccount(buffer_timeout_e, start, timeout);
+	pos = ATOMIC_LOAD_RLX(&in);
+	while(TRUE)
+	{
+		slot = MPMC_SLOT(pos);
+		diff = MPMC_DIFF(ATOMIC_LOAD_ACQ(&slotSeq[slot]), pos);
+		if(diff == 0)
+		{
+			if(atomicCompareExchange(&in, pos, MPMC_ADD(pos, 1)))
+				break;
+		}
+		else if(diff < 0)
+			Task_yield();				//slot's previous item is still being consumed
+		pos = ATOMIC_LOAD_RLX(&in);
+	}
+	if(SLOT_IS_FULL(slot))
+	{
+		// The position is claimed and cannot be given back - hand it over to its consumer as
+		// an empty slot, so that it reports the abnormal behaviour too and frees the slot
+		TRACE_ERROR(INSERT_ERROR, ITEM_VALUE(item), 0);
+		SLOT_SET_EMPTY(slot);
+		ATOMIC_STORE_REL(&slotSeq[slot], MPMC_ADD(pos, 1));
+		SEM_POST(fullSlots);
+		return buffer_error_e;
+	}
+	buffer[slot] = item;
+	SLOT_SET_FULL(slot);
+	SLOT_STAMP(slot);
+	ATOMIC_STORE_REL(&slotSeq[slot], MPMC_ADD(pos, 1));
+	TRACE_DEBUG(PRODUCED, ITEM_VALUE(item),
+		  MPMC_DIFF(ATOMIC_LOAD_RLX(&in), ATOMIC_LOAD_RLX(&out)));
+	SEM_POST(fullSlots);
+	return deadlineAccount(buffer_ok_e, start, timeout);
+}
+
+/*---------------------------------------------------------------------------
+Function name: remove_item_timeout (MPMC engine)
+Description: Removes an item from the buffer without taking the mutex
+Input: BufferItem_T *item, UInt32 timeout
+Output: BufferStatus_E- buffer_ok_e if an item was removed, buffer_error_e
+		if not, buffer_timeout_e if the deadline passed first.
+Algorithm: Wait on fullSlots as usual (until the deadline at most). Then
+		   claim position "out" with a compare-and-swap, once the item of that
+		   position was published (its slot's sequence equals the position +
+		   1). Check the slot is not empty, take the item, mark the slot empty
+		   and free it for the next lap, then signal the producers.
+---------------------------------------------------------------------------*/
+BufferStatus_E remove_item_timeout(BufferItem_T *item, UInt32 timeout)
+{
+	Int pos, slot, diff;
+	UInt32 start = deadlineStart(timeout);
+
+	if(!SEM_PEND(fullSlots, timeout))
+		return deadlineAccount(buffer_timeout_e, start, timeout);
+	pos = ATOMIC_LOAD_RLX(&out);
+	while(TRUE)
+	{
+		slot = MPMC_SLOT(pos);
+		diff = MPMC_DIFF(ATOMIC_LOAD_ACQ(&slotSeq[slot]), MPMC_ADD(pos, 1));
+		if(diff == 0)
+		{
+			if(atomicCompareExchange(&out, pos, MPMC_ADD(pos, 1)))
+				break;
+		}
+		else if(diff < 0)
+			Task_yield();				//item of this position is still being produced
+		pos = ATOMIC_LOAD_RLX(&out);
+	}
+	if(SLOT_IS_EMPTY(slot))
+	{
+		TRACE_ERROR(REMOVE_ERROR, 0, 0);
+		ATOMIC_STORE_REL(&slotSeq[slot], MPMC_ADD(pos, BUFFER_SIZE));
+		SEM_POST(emptySlots);
+		return buffer_error_e;
+	}
+	*item = buffer[slot];
+	SLOT_LATENCY(slot);
+	SLOT_SET_EMPTY(slot);
+	ATOMIC_STORE_REL(&slotSeq[slot], MPMC_ADD(pos, BUFFER_SIZE));
+	TRACE_DEBUG(CONSUMED, ITEM_VALUE(*item),
+		  MPMC_DIFF(ATOMIC_LOAD_RLX(&in), ATOMIC_LOAD_RLX(&out)));
+	SEM_POST(emptySlots);
+	return deadlineAccount(buffer_ok_e, start, timeout);
+}
+
+/*---------------------------------------------------------------------------
+Function name: insert_items (MPMC engine)
+Description: Inserts up to n items to the buffer with one position claim
+Input: const BufferItem_T *items, Int n
+Output: Int- number of items inserted (0 on abnormal behaviour).
+Algorithm: Take between 1 and n empty slots (pendUpTo) and claim as many
+		   consecutive positions with a single compare-and-swap of "in". Fill
+		   each claimed slot once its previous item has been consumed. After an
+		   abnormal slot, the remaining claimed positions are handed over empty
+		   (see insert_item). Then signal the consumers.
+---------------------------------------------------------------------------*/
+Int insert_items(const BufferItem_T *items, Int n)
+{
+	Int claimed = pendUpTo(emptySlots, n);
+	Int inserted = 0;
+	Bool failed = FALSE;
+	Int pos, slot, i;
+	do
+		pos = ATOMIC_LOAD_RLX(&in);
+	while(!atomicCompareExchange(&in, pos, MPMC_ADD(pos, claimed)));
+	for(i = 0; i < claimed; i++, pos = MPMC_ADD(pos, 1))
+	{
+		slot = MPMC_SLOT(pos);
+		while(MPMC_DIFF(ATOMIC_LOAD_ACQ(&slotSeq[slot]), pos) < 0)
+			Task_yield();				//slot's previous item is still being consumed
+		if(!failed && SLOT_IS_FULL(slot))
+		{
+			TRACE_ERROR(INSERT_ITEMS_ERROR, ITEM_VALUE(items[i]), 0);
+			failed = TRUE;
+		}
+		if(failed)
+			SLOT_SET_EMPTY(slot);
+		else
+		{
+			buffer[slot] = items[i];
+			SLOT_SET_FULL(slot);
+			SLOT_STAMP(slot);
+			inserted++;
+		}
+		ATOMIC_STORE_REL(&slotSeq[slot], MPMC_ADD(pos, 1));
+	}
+	for(i = 0; i < inserted; i++)
+		TRACE_DEBUG(PRODUCED, ITEM_VALUE(items[i]),
+			  MPMC_DIFF(ATOMIC_LOAD_RLX(&in), ATOMIC_LOAD_RLX(&out)));
+	postN(fullSlots, claimed);
+	return inserted;
+}
+
+/*---------------------------------------------------------------------------
+Function name: remove_items (MPMC engine)
+Description: Removes up to max items from the buffer with one position claim
+Input: BufferItem_T *items, Int max
+Output: Int- number of items removed (0 on abnormal behaviour).
+Algorithm: Take between 1 and max full slots (pendUpTo) and claim as many
+		   consecutive positions with a single compare-and-swap of "out". Take
+		   each claimed item once it has been published, mark its slot empty and
+		   free it for the next lap (empty slots are skipped and reported once).
+		   Then signal the producers.
+---------------------------------------------------------------------------*/
+Int remove_items(BufferItem_T *items, Int max)
+{
+	Int claimed = pendUpTo(fullSlots, max);
+	Int removed = 0;
+	Bool failed = FALSE;
+	Int pos, slot, i;
+	do
+		pos = ATOMIC_LOAD_RLX(&out);
+	while(!atomicCompareExchange(&out, pos, MPMC_ADD(pos, claimed)));
+	for(i = 0; i < claimed; i++, pos = MPMC_ADD(pos, 1))
+	{
+		slot = MPMC_SLOT(pos);
+		while(MPMC_DIFF(ATOMIC_LOAD_ACQ(&slotSeq[slot]), MPMC_ADD(pos, 1)) < 0)
+			Task_yield();				//item of this position is still being produced
+		if(!failed && SLOT_IS_EMPTY(slot))
+		{
+			TRACE_ERROR(REMOVE_ITEMS_ERROR, slot, 0);
+			failed = TRUE;
+		}
+		if(!failed)
+		{
+			items[removed++] = buffer[slot];
+			SLOT_LATENCY(slot);
+		}
+		SLOT_SET_EMPTY(slot);
+		ATOMIC_STORE_REL(&slotSeq[slot], MPMC_ADD(pos, BUFFER_SIZE));
+	}
+	for(i = 0; i < removed; i++)
+		TRACE_DEBUG(CONSUMED, ITEM_VALUE(items[i]),
+			  MPMC_DIFF(ATOMIC_LOAD_RLX(&in), ATOMIC_LOAD_RLX(&out)));
+	postN(emptySlots, claimed);
+	return removed;
+}
+#endif
+
+/*---------------------------------------------------------------------------
+Function name: insert_item
+Description: Inserts an item to the buffer
+Input: BufferItem_T item
+Output: Bool- True if an item was inserted, False if not.
+Algorithm: insert_item_timeout of the selected engine, with no deadline.
+---------------------------------------------------------------------------*/
+Bool insert_item(BufferItem_T item)
+{
+	return insert_item_timeout(item, BIOS_WAIT_FOREVER) == buffer_ok_e;
+}
+
+/*---------------------------------------------------------------------------
+Function name: remove_item
+Description: Removes an item from the buffer
+Input: BufferItem_T *item
+Output: Bool- True if an item was removed, False if not.
+Algorithm: remove_item_timeout of the selected engine, with no deadline.
+---------------------------------------------------------------------------*/
+Bool remove_item(BufferItem_T *item)
+{
+	return remove_item_timeout(item, BIOS_WAIT_FOREVER) == buffer_ok_e;
+}
+
+/*---------------------------------------------------------------------------
+Function name: deadlineStart
+Description: Start of a call's deadline
+Input: UInt32 timeout
+Output: UInt32- the current Clock tick (0 for BIOS_WAIT_FOREVER).
+Algorithm: Read Clock_getTicks only if there is a deadline.
+---------------------------------------------------------------------------*/
+UInt32 deadlineStart(UInt32 timeout)
+{
+	return timeout != BIOS_WAIT_FOREVER ? Clock_getTicks() : 0;
+}
+
+/*---------------------------------------------------------------------------
+Function name: deadlineLeft
+Description: Timeout left until a deadline
+Input: UInt32 start, UInt32 timeout
+Output: UInt32- the timeout for the next pend.
+Algorithm: BIOS_WAIT_FOREVER stays; otherwise subtract the ticks elapsed since
+		   "start", down to BIOS_NO_WAIT.
+---------------------------------------------------------------------------*/
+UInt32 deadlineLeft(UInt32 start, UInt32 timeout)
+{
+	UInt32 elapsed;
+
+	if(timeout == BIOS_WAIT_FOREVER)
+		return timeout;
+	elapsed = Clock_getTicks() - start;
+	return elapsed < timeout ? timeout - elapsed : BIOS_NO_WAIT;
+}
+
+/*---------------------------------------------------------------------------
+Function name: deadlineAccount
+Description: Count timeouts and deadline misses
+Input: BufferStatus_E status, UInt32 start, UInt32 timeout
+Output: BufferStatus_E- status.
+Algorithm: Only for calls with a deadline: count a buffer_timeout_e in the
+		   running Task's timeouts, and a buffer_ok_e later than start +
+		   timeout in its deadlineMisses (tracing by how many ticks).
+---------------------------------------------------------------------------*/
+BufferStatus_E deadlineAccount(BufferStatus_E status, UInt32 start, UInt32 timeout)
+{
+	volatile StatsRow_T *stats;
+	UInt32 elapsed;
+
+	if(timeout == BIOS_WAIT_FOREVER)
+		return status;
+	stats = statsRegister();
+	if(status == buffer_timeout_e)
+		statsAdd(stats, &stats->counts.timeouts, 1);
+	else if(status == buffer_ok_e)
+	{
+		elapsed = Clock_getTicks() - start;
+		if(elapsed > timeout)
+		{
+			statsAdd(stats, &stats->counts.deadlineMisses, 1);
+			TRACE_INFO(DEADLINE_MISS, elapsed - timeout, timeout);
+		}
+	}
+	return status;
+}
+
+/*---------------------------------------------------------------------------
+Function name: atomicExchange
+Description: Atomic exchange of a flag
+Input: volatile Bool *flag, Bool value
+Output: Bool- the previous value of *flag.
+Algorithm: On the target, read and write the flag with interrupts disabled (so
+		   no Task switch can happen in between). On the host, use the
+		   compiler's atomic exchange builtin.
+---------------------------------------------------------------------------*/
+Bool atomicExchange(volatile Bool *flag, Bool value)
+{
+#if defined(__TI_COMPILER_VERSION__)
+	UInt key = Hwi_disable();
+	Bool previous = *flag;
+	*flag = value;
+	Hwi_restore(key);
+	return previous;
+#else
+	return __atomic_exchange_n(flag, value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+/*---------------------------------------------------------------------------
+Function name: atomicCompareExchange
+Description: Atomic compare-and-swap of an Int
+Input: volatile Int *var, Int expected, Int desired
+Output: Bool- True if *var held "expected" and was set to "desired".
+Algorithm: On the target, compare and write with interrupts disabled. On the
+		   host, use the compiler's compare-and-swap builtin.
+---------------------------------------------------------------------------*/
+Bool atomicCompareExchange(volatile Int *var, Int expected, Int desired)
+{
+#if defined(__TI_COMPILER_VERSION__)
+	UInt key = Hwi_disable();
+	Bool swapped = (*var == expected);
+	if(swapped)
+		*var = desired;
+	Hwi_restore(key);
+	return swapped;
+#else
+	return __atomic_compare_exchange_n(var, &expected, desired, FALSE,
+									   __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+#endif
+}
+
+/*---------------------------------------------------------------------------
+Function name: rngEntropyInit
+Description: Read the boot entropy
+Input: None
+Output: None
+Algorithm: Turn on the 1.5 V reference and the ADC12 on the temperature
+		   sensor (channel 10), wait for the reference to settle and convert
+		   32 times. The two lowest bits of a reading are noise: rotate the
+		   result by two and XOR them in each time, so that every bit of
+		   rngBootEntropy gets two readings' worth. Turn both modules off.
+---------------------------------------------------------------------------*/
+void rngEntropyInit(void)
+{
+#if defined(__TI_COMPILER_VERSION__)
+	UInt32 x = 0;
+	Int i;
+
+	REFCTL0 |= REFMSTR | REFVSEL_0 | REFON;
+	ADC12CTL0 = ADC12SHT0_8 | ADC12ON;			//256 ADC12CLK cycles of sampling
+	ADC12CTL1 = ADC12SHP;						//sampling timer, one channel, one conversion
+	ADC12MCTL0 = ADC12SREF_1 | ADC12INCH_10;	//VREF+/AVSS, temperature sensor
+	__delay_cycles(MCLK_DESIRED_FREQUENCY_IN_KHZ / 10);	//100 us for the reference
+	for(i = 0; i < 32; i++)
+	{
+		ADC12CTL0 |= ADC12ENC | ADC12SC;
+		while(ADC12CTL1 & ADC12BUSY)
+			;
+		x = ((x << 2) | (x >> 30)) ^ (ADC12MEM0 & 0x3);
+	}
+	ADC12CTL0 &= ~ADC12ENC;
+	ADC12CTL0 &= ~ADC12ON;
+	REFCTL0 &= ~REFON;
+	rngBootEntropy = x;
+#endif
+}
+
+/*---------------------------------------------------------------------------
+Function name: rngSeed
+Description: Initial state of a producer's random generator
+Input: UArg id
+Output: UInt32- a non-zero xorshift32 state.
+Algorithm: Combine the producer ID with RNG_SEED (or RNG_ENTROPY()) and
+		   scramble the bits (murmur3 finaliser), so that consecutive IDs and
+		   close timestamps give unrelated sequences.
+---------------------------------------------------------------------------*/
+UInt32 rngSeed(UArg id)
+{
+#if RNG_SEED
+	UInt32 x = (UInt32)RNG_SEED;
+#else
+	UInt32 x = (UInt32)RNG_ENTROPY();
+#endif
+	x ^= (UInt32)id * 0x9E3779B9UL;
+	x ^= x >> 16;
+	x *= 0x85EBCA6BUL;
+	x ^= x >> 13;
+	x *= 0xC2B2AE35UL;
+	x ^= x >> 16;
+	return x != 0 ? x : 0x6D2B79F5UL;
+}
+
+/*---------------------------------------------------------------------------
+Function name: rngNext
+Description: Next pseudo-random number
+Input: UInt32 *state
+Output: UInt32- the new state.
+Algorithm: xorshift32 (shifts 13, 17, 5) - never returns 0 for a non-zero
+		   state.
+---------------------------------------------------------------------------*/
+UInt32 rngNext(UInt32 *state)
+{
+	UInt32 x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+/*---------------------------------------------------------------------------
+Function name: rngRange
+Description: Unbiased pseudo-random number below a bound
+Input: UInt32 *state, UInt32 range
+Output: Int- a value in 0..range-1.
+Algorithm: Lemire's method: the high 32 bits of x * range are uniform in
+		   0..range-1 once the products whose low 32 bits fall below
+		   2^32 mod range are rejected. That remainder is only computed in
+		   the rare case the low bits are below range.
+---------------------------------------------------------------------------*/
+Int rngRange(UInt32 *state, UInt32 range)
+{
+	UInt64 m = (UInt64)rngNext(state) * range;
+	UInt32 low = (UInt32)m;
+	UInt32 threshold;
+
+	if(low < range)
+	{
+		threshold = (UInt32)(0 - range) % range;
+		while(low < threshold)
+		{
+			m = (UInt64)rngNext(state) * range;
+			low = (UInt32)m;
+		}
+	}
+	return (Int)(m >> 32);
+}
+
+#if WORKLOAD == WORKLOAD_POISSON || SERVICE == SERVICE_EXPONENTIAL || SERVICE == SERVICE_HEAVY_TAIL
+/*---------------------------------------------------------------------------
+Function name: expSampleQ16
+Description: Exponentially distributed pseudo-random number
+Input: UInt32 *state
+Output: UInt32- a sample of an exponential distribution with mean 1, in
+		units of 1/65536.
+Algorithm: -ln(U) for U = x/2^32 uniform: -ln(U) = (32 - log2(x)) * ln(2).
+		   log2(x) is the position of the top bit of x plus 16 fraction bits
+		   found by repeated squaring of the normalised mantissa - integer
+		   arithmetic only.
+---------------------------------------------------------------------------*/
+static UInt32 expSampleQ16(UInt32 *state)
+{
+	UInt32 x = rngNext(state);				//never 0
+	UInt32 mantissa, log2Q16;
+	Int topBit = 31, i;
+
+	while(!(x & 0x80000000UL))
+	{
+		x <<= 1;
+		topBit--;
+	}
+	mantissa = x >> 1;						//1.0 <= mantissa < 2.0, in units of 2^-30
+	log2Q16 = (UInt32)topBit << 16;
+	for(i = 15; i >= 0; i--)
+	{
+		mantissa = (UInt32)(((UInt64)mantissa * mantissa) >> 30);
+		if(mantissa >= 0x80000000UL)
+		{
+			mantissa >>= 1;
+			log2Q16 |= (UInt32)1 << i;
+		}
+	}
+	return (UInt32)((((UInt64)32 << 16) - log2Q16) * 45426UL >> 16);	//ln(2) = 45426/65536
+}
+#endif
+
+#if WORKLOAD == WORKLOAD_TRACE
+//The recorded trace: gap before the item (microseconds) and its value
+static const struct
+{
+	UInt32 gapUs;
+	Int value;
+} workloadTrace[] = { WORKLOAD_TRACE_ENTRIES };
+#define WORKLOAD_TRACE_LENGTH ((Int)(sizeof(workloadTrace) / sizeof(workloadTrace[0])))
+#endif
+
+/*---------------------------------------------------------------------------
+Function name: workloadInit
+Description: Set up a producer's workload model
+Input: Workload_T *workload, UArg producerId
 Output: None
-Algorithm: Wait until it can write to ledSrvTask Env and then posts his
-		   semaphore to get his service.
+Algorithm: Seed the generator, look the producer's rate up in
+		   WORKLOAD_RATES and make the first item due now.
 ---------------------------------------------------------------------------*/
-void prepForLedSrv(LedBlinksInfo_T* ledBlinkInfo)
+void workloadInit(Workload_T *workload, UArg producerId)
 {
-	Semaphore_pend(setLedEnvMutex, BIOS_WAIT_FOREVER);
-	Task_setEnv(ledSrvTask, (Ptr)ledBlinkInfo);
-	Semaphore_post(ledSrvSchedSem);
-	Semaphore_post(setLedEnvMutex);
+	static const UInt32 rates[] = { WORKLOAD_RATES };
+	Int rateIndex = (Int)producerId - 1;
+	UInt32 rate;
+
+	if(rateIndex >= (Int)(sizeof(rates) / sizeof(rates[0])))
+		rateIndex = sizeof(rates) / sizeof(rates[0]) - 1;
+	if(rateIndex < 0)
+		rateIndex = 0;
+	rate = rates[rateIndex] > 0 ? rates[rateIndex] : 1;
+	workload->rng = rngSeed(producerId);
+	workload->meanGapUs = 1000000UL / rate;
+	workload->dueTick = Clock_getTicks();
+	workload->dueUs = 0;
+	workload->phaseUs = 0;
+	workload->traceIndex = 0;
 }
 
 /*---------------------------------------------------------------------------
-Function name: ledSrvTaskHandler
-Description: LEDs manager
+Function name: workloadNext
+Description: Wait for and generate the next item of a producer
+Input: Workload_T *workload
+Output: Int- the item value.
+Algorithm: Sleep until the due tick (wrap-safe tick difference). Then pick
+		   the gap to the next item - constant, exponential, constant with
+		   a jump to the next burst, or from the trace - and add it to the
+		   due time, carrying whole ticks into dueTick.
+---------------------------------------------------------------------------*/
+Int workloadNext(Workload_T *workload)
+{
+#if WORKLOAD == WORKLOAD_SATURATE
+	return rngRange(&workload->rng, VAL_RANGE) + MIN_VAL_NUM;
+#else
+	Int32 ahead = (Int32)(workload->dueTick - Clock_getTicks());
+	UInt32 gapUs;
+	Int value;
+
+	if(ahead > 0)
+		Task_sleep((UInt32)ahead);
+#if WORKLOAD == WORKLOAD_TRACE
+	value = workloadTrace[workload->traceIndex].value;
+	if(++workload->traceIndex == WORKLOAD_TRACE_LENGTH)
+		workload->traceIndex = 0;
+	gapUs = workloadTrace[workload->traceIndex].gapUs;
+#else
+	value = rngRange(&workload->rng, VAL_RANGE) + MIN_VAL_NUM;
+#if WORKLOAD == WORKLOAD_POISSON
+	gapUs = (UInt32)(((UInt64)workload->meanGapUs * expSampleQ16(&workload->rng)) >> 16);
+#else
+	gapUs = workload->meanGapUs;
+#endif
+#if WORKLOAD == WORKLOAD_BURSTY
+	if(workload->phaseUs + gapUs >= (UInt32)WORKLOAD_ON_MS * 1000UL)
+	{
+		gapUs = (UInt32)(WORKLOAD_ON_MS + WORKLOAD_OFF_MS) * 1000UL - workload->phaseUs;
+		workload->phaseUs = 0;
+	}
+	else
+		workload->phaseUs += gapUs;
+#endif
+#endif
+	workload->dueUs += gapUs;
+	workload->dueTick += workload->dueUs / Clock_tickPeriod;
+	workload->dueUs %= Clock_tickPeriod;
+	return value;
+#endif
+}
+
+#if SERVICE != SERVICE_NONE
+#if SERVICE == SERVICE_HEAVY_TAIL
+/*---------------------------------------------------------------------------
+Function name: exp2Q16
+Description: 2 to a fractional power
+Input: UInt32 xQ16
+Output: UInt64- 2^(xQ16/65536), in units of 1/65536 (saturated at 2^47).
+Algorithm: Shift by the integer part; the fraction f uses the cubic
+		   2^f ~= 1 + f*(0.6951 + f*(0.2262 + f*0.0782)) (error < 0.02%).
+---------------------------------------------------------------------------*/
+static UInt64 exp2Q16(UInt32 xQ16)
+{
+	UInt32 f = xQ16 & 0xFFFF;
+	UInt32 intPart = xQ16 >> 16;
+	UInt64 frac;
+
+	if(intPart > 31)
+		intPart = 31;
+	frac = (UInt64)f * 5125 >> 16;						//0.0782
+	frac = (UInt64)f * (14824 + frac) >> 16;			//0.2262
+	frac = (UInt64)f * (45554 + frac) >> 16;			//0.6951
+	return (65536 + frac) << intPart;
+}
+#endif
+
+/*---------------------------------------------------------------------------
+Function name: serviceInit
+Description: Set up a consumer's service-time model
+Input: Service_T *service, UArg consumerId
+Output: None
+Algorithm: Seed the generator (apart from the producers' ones) and look the
+		   consumer's mean up in SERVICE_TIMES_US.
+---------------------------------------------------------------------------*/
+void serviceInit(Service_T *service, UArg consumerId)
+{
+	static const UInt32 means[] = { SERVICE_TIMES_US };
+	Int meanIndex = (Int)consumerId - 1;
+
+	if(meanIndex >= (Int)(sizeof(means) / sizeof(means[0])))
+		meanIndex = sizeof(means) / sizeof(means[0]) - 1;
+	if(meanIndex < 0)
+		meanIndex = 0;
+	service->rng = rngSeed(consumerId + 0x8000);
+	service->meanUs = means[meanIndex];
+	service->owedUs = 0;
+}
+
+/*---------------------------------------------------------------------------
+Function name: serviceItem
+Description: Serve one consumed item
+Input: Service_T *service, Int value
+Output: None
+Algorithm: Draw the service time: the mean; mean * E (E exponential with
+		   mean 1); mean * value / average value; or a Pareto sample
+		   xm * 2^(E / (shape * ln 2)) with xm = mean * (shape - 1) / shape.
+		   Add it to the time owed and sleep the whole ticks of it.
+---------------------------------------------------------------------------*/
+void serviceItem(Service_T *service, Int value)
+{
+	UInt32 serviceUs, ticks;
+#if SERVICE == SERVICE_FIXED
+	serviceUs = service->meanUs;
+#elif SERVICE == SERVICE_EXPONENTIAL
+	serviceUs = (UInt32)(((UInt64)service->meanUs * expSampleQ16(&service->rng)) >> 16);
+#elif SERVICE == SERVICE_PROPORTIONAL
+	serviceUs = (UInt32)((UInt64)service->meanUs * 2 * (UInt32)value / (MIN_VAL_NUM + MAX_VAL_NUM));
+#elif SERVICE == SERVICE_HEAVY_TAIL
+	{
+		//E / (shape * ln 2) in Q16: 1/ln(2) = 94548/65536, shape = SERVICE_PARETO_SHAPE_X10/10
+		UInt64 exponent = (UInt64)expSampleQ16(&service->rng) * 94548 / 65536 * 10 / SERVICE_PARETO_SHAPE_X10;
+		UInt64 xm = (UInt64)service->meanUs * (SERVICE_PARETO_SHAPE_X10 - 10) / SERVICE_PARETO_SHAPE_X10;
+		UInt64 sample = xm * exp2Q16(exponent > 0x1FFFFFUL ? 0x1FFFFFUL : (UInt32)exponent) >> 16;
+		serviceUs = sample > 0xFFFFFFFFUL ? 0xFFFFFFFFUL : (UInt32)sample;
+	}
+#endif
+	(void)value;
+	service->owedUs += serviceUs;
+	ticks = service->owedUs / Clock_tickPeriod;
+	service->owedUs %= Clock_tickPeriod;
+	if(ticks > 0)
+		Task_sleep(ticks);
+}
+#endif
+
+/*---------------------------------------------------------------------------
+Function name: pendUpTo
+Description: Take between 1 and n units of a counting semaphore
+Input: Semaphore_Handle sem, Int n
+Output: Int- number of units taken.
+Algorithm: Block for the first unit, then take more only as long as they are
+		   available without blocking (BIOS_NO_WAIT).
+---------------------------------------------------------------------------*/
+Int pendUpTo(Semaphore_Handle sem, Int n)
+{
+	Int taken = 1;
+	SEM_PEND(sem, BIOS_WAIT_FOREVER);
+	while(taken < n && SEM_PEND(sem, BIOS_NO_WAIT))
+		taken++;
+	return taken;
+}
+
+/*---------------------------------------------------------------------------
+Function name: postN
+Description: Give n units of a counting semaphore
+Input: Semaphore_Handle sem, Int n
+Output: None
+Algorithm: Post the semaphore n times.
+---------------------------------------------------------------------------*/
+void postN(Semaphore_Handle sem, Int n)
+{
+	while(n-- > 0)
+		SEM_POST(sem);
+}
+
+/*---------------------------------------------------------------------------
+Function name: ledToggle
+Description: Blink LEDs
+Input: uint8_t selectedPort, uint16_t selectedPins, int times
+Output: None
+Algorithm: Toggle the LED once and leave the remaining toggles to
+		   ledBlinkClkHandler, by starting the one-shot ledBlinkClk.
+---------------------------------------------------------------------------*/
+void ledToggle(uint8_t selectedPort, uint16_t selectedPins, int times)
+{
+	if(times <= 0)
+	{
+		SEM_POST(ledBlinkDoneSem);
+		return;
+	}
+	ledBlinkPort = selectedPort;
+	ledBlinkPins = selectedPins;
+	ledTogglesLeft = (times << 1) - 1;
+	GPIO_toggleOutputOnPin(selectedPort, selectedPins);
+	Clock_setTimeout(ledBlinkClk, ledToggleTicks);
+	Clock_start(ledBlinkClk);
+}
+
+/*---------------------------------------------------------------------------
+Function name: ledSetMaxBlinkRate
+Description: Set the maximum LED blinking rate
+Input: UInt blinksPerSec
+Output: None
+Algorithm: A blink is two toggles, so the gap between toggles is
+		   1s / (2 * blinksPerSec), in Clock ticks of Clock_tickPeriod us.
+---------------------------------------------------------------------------*/
+void ledSetMaxBlinkRate(UInt blinksPerSec)
+{
+	UInt32 ticks = LED_TOGGLE_TICKS;
+	if(blinksPerSec > 0)
+	{
+		ticks = 1000000UL / ((UInt32)Clock_tickPeriod * 2 * blinksPerSec);
+		if(ticks == 0)
+			ticks = 1;
+	}
+	ledToggleTicks = ticks;
+}
+
+/*---------------------------------------------------------------------------
+Function name: ledBlinkClkHandler
+Description: The LED blinking clock function
+Input: UArg arg
+Output: None
+Algorithm: If toggles are left, toggle the LED and restart ledBlinkClk;
+		   otherwise the trailing gap is over - post ledBlinkDoneSem.
+---------------------------------------------------------------------------*/
+void ledBlinkClkHandler(UArg arg)
+{
+	if(ledTogglesLeft > 0)
+	{
+		GPIO_toggleOutputOnPin(ledBlinkPort, ledBlinkPins);
+		ledTogglesLeft--;
+		Clock_start(ledBlinkClk);
+	}
+	else
+		Semaphore_post(ledBlinkDoneSem);
+}
+
+#if LATENCY_STATS
+/*---------------------------------------------------------------------------
+Function name: latencyBucket
+Description: Histogram bucket of a latency
+Input: UInt32 latency
+Output: Int- index into latencyHist.
+Algorithm: Values below LATENCY_SUB_BUCKETS get a bucket each. Above that,
+		   the power of two of the value selects a row of LATENCY_SUB_BUCKETS
+		   buckets and the LATENCY_SUB_BITS bits below its top bit select the
+		   bucket in the row.
+---------------------------------------------------------------------------*/
+static Int latencyBucket(UInt32 latency)
+{
+	Int topBit = 0;
+	UInt32 v = latency;
+	if(latency < LATENCY_SUB_BUCKETS)
+		return (Int)latency;
+	if(v >> 16) { v >>= 16; topBit += 16; }
+	if(v >> 8) { v >>= 8; topBit += 8; }
+	if(v >> 4) { v >>= 4; topBit += 4; }
+	if(v >> 2) { v >>= 2; topBit += 2; }
+	if(v >> 1) topBit += 1;
+	return (topBit - LATENCY_SUB_BITS + 1) * LATENCY_SUB_BUCKETS +
+		   (Int)((latency >> (topBit - LATENCY_SUB_BITS)) & (LATENCY_SUB_BUCKETS - 1));
+}
+
+/*---------------------------------------------------------------------------
+Function name: latencyBucketTop
+Description: Largest latency of a histogram bucket
+Input: Int bucket
+Output: UInt32- the upper edge of the bucket.
+Algorithm: Inverse of latencyBucket.
+---------------------------------------------------------------------------*/
+static UInt32 latencyBucketTop(Int bucket)
+{
+	Int shift;
+	if(bucket < LATENCY_SUB_BUCKETS)
+		return (UInt32)bucket;
+	shift = bucket / LATENCY_SUB_BUCKETS - 1;
+	return (((UInt32)(LATENCY_SUB_BUCKETS + bucket % LATENCY_SUB_BUCKETS) << shift) - 1) +
+		   ((UInt32)1 << shift);
+}
+
+/*---------------------------------------------------------------------------
+Function name: latencyRecord
+Description: Record the buffer latency of an item
+Input: UInt32 latency
+Output: None
+Algorithm: Count the latency in its bucket and raise latencyMax if needed -
+		   with interrupts disabled on the target, with atomic builtins on the
+		   host.
+---------------------------------------------------------------------------*/
+void latencyRecord(UInt32 latency)
+{
+	Int bucket = latencyBucket(latency);
+#if defined(__TI_COMPILER_VERSION__)
+	UInt key = Hwi_disable();
+	latencyHist[bucket]++;
+	if(latency > latencyMax)
+		latencyMax = latency;
+	Hwi_restore(key);
+#else
+	UInt32 max = __atomic_load_n(&latencyMax, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&latencyHist[bucket], 1, __ATOMIC_RELAXED);
+	while(latency > max &&
+		  !__atomic_compare_exchange_n(&latencyMax, &max, latency, TRUE,
+									   __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+#endif
+}
+
+/*---------------------------------------------------------------------------
+Function name: latencySnapshot
+Description: Summarise the latency histogram
+Input: LatencyStats_T *stats
+Output: None
+Algorithm: Sum the bucket counts, then walk the buckets again to the ranks
+		   of the 50th/99th/99.9th percentile (count - count/2, count -
+		   count/100 and count - count/1000 - no 32 bit overflow). Counts only
+		   grow, so items recorded between the passes just end the walk
+		   earlier.
+---------------------------------------------------------------------------*/
+void latencySnapshot(LatencyStats_T *stats)
+{
+	UInt32 ranks[3], cumulative = 0, top;
+	UInt32 *results[3];
+	Int bucket, r = 0;
+
+	stats->count = 0;
+	for(bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+		stats->count += ATOMIC_LOAD_RLX(&latencyHist[bucket]);
+	stats->max = ATOMIC_LOAD_RLX(&latencyMax);
+	stats->p50 = stats->p99 = stats->p999 = stats->max;
+	ranks[0] = stats->count - stats->count / 2;
+	ranks[1] = stats->count - stats->count / 100;
+	ranks[2] = stats->count - stats->count / 1000;
+	results[0] = &stats->p50;
+	results[1] = &stats->p99;
+	results[2] = &stats->p999;
+	for(bucket = 0; bucket < LATENCY_BUCKETS && r < 3 && stats->count > 0; bucket++)
+	{
+		cumulative += ATOMIC_LOAD_RLX(&latencyHist[bucket]);
+		top = latencyBucketTop(bucket);
+		while(r < 3 && cumulative >= ranks[r])
+			*results[r++] = top < stats->max ? top : stats->max;
+	}
+}
+
+/*---------------------------------------------------------------------------
+Function name: latencyDump
+Description: Log the latency percentiles
 Input: None
 Output: None
-Algorithm: Wait until a producer/consumer need his service, then read the
-		   data they sent him from his environment and blink the neede LED.
+Algorithm: Take a latencySnapshot and Log it, in Timestamp_get32() units.
 ---------------------------------------------------------------------------*/
-void ledSrvTaskHandler(void)
+void latencyDump(void)
 {
-	Task_Handle taskHandle = Task_self();
-	LedBlinksInfo_T* ledBlinkInfo;
-	while(TRUE)
+	LatencyStats_T stats;
+	latencySnapshot(&stats);
+	Log_info2("Latency: items = %u; max = %u", stats.count, stats.max);
+	Log_info2("Latency: p50 = %u; p99 = %u", stats.p50, stats.p99);
+	Log_info1("Latency: p999 = %u", stats.p999);
+}
+#endif
+
+/*---------------------------------------------------------------------------
+Function name: stackDump
+Description: Log the stack high-water marks
+Input: None
+Output: None
+Algorithm: Task_stat of every statically created Task (the host build has
+		   no idle Task), then Hwi_getStackInfo for the system stack.
+---------------------------------------------------------------------------*/
+void stackDump(void)
+{
+	Task_Handle tasks[6];
+	Task_Stat stat;
+	Int i;
+
+	tasks[0] = producerTask1;
+	tasks[1] = producerTask2;
+	tasks[2] = consumerTask1;
+	tasks[3] = consumerTask2;
+	tasks[4] = ledSrvTask;
+	tasks[5] = Task_getIdleTask();
+	for(i = 0; i < 6; i++)
 	{
-		Semaphore_pend(ledSrvSchedSem, BIOS_WAIT_FOREVER);
-		ledBlinkInfo = (LedBlinksInfo_T *)Task_getEnv(taskHandle);
-		if(ledBlinkInfo->led == green_e)
-			ledToggle(GREEN, ledBlinkInfo->blinksNum);
-		else
-			ledToggle(RED, ledBlinkInfo->blinksNum);
+		if(tasks[i] == NULL)
+			continue;
+		Task_stat(tasks[i], &stat);
+		Log_info2("Stack: Task = %s; used = %u", (IArg)Task_Handle_name(tasks[i]), (IArg)stat.used);
+		Log_info2("Stack: size = %u; free = %u", (IArg)stat.stackSize, (IArg)(stat.stackSize - stat.used));
 	}
+#if defined(__TI_COMPILER_VERSION__)
+	{
+		Hwi_StackInfo info;
+		Hwi_getStackInfo(&info, TRUE);
+		Log_info2("Stack: system stack used = %u of %u", (IArg)info.hwiStackPeak, (IArg)info.hwiStackSize);
+	}
+#endif
 }
 
+#if SEM_PROFILE
 /*---------------------------------------------------------------------------
-Function name: insert_item
-Description: Inserts an item to the buffer
-Input: Int item
-Output: Bool- True if an item was inserted, False if not.
-Algorithm: Wait until there is empty space in the buffer, then check if the next
-		   place is empty, if it is- it inserts the item, increase count,
-		   advance "in" variable and issue a log message, then signals the
-		   consumers.
+Function name: semProfileSem
+Description: semProfile column of a semaphore
+Input: Semaphore_Handle sem
+Output: Int- 0 to SEM_PROFILE_SEMS-1, or -1 for other semaphores.
+Algorithm: Compare with the statically created semaphores.
+---------------------------------------------------------------------------*/
+static Int semProfileSem(Semaphore_Handle sem)
+{
+	if(sem == emptySlots)
+		return 0;
+	if(sem == fullSlots)
+		return 1;
+	if(sem == mutex)
+		return 2;
+	if(sem == setLedEnvMutex)
+		return 3;
+	if(sem == ledSrvSchedSem)
+		return 4;
+	if(sem == ledBlinkDoneSem)
+		return 5;
+	return -1;
+}
+
+/*---------------------------------------------------------------------------
+Function name: semProfileCell
+Description: semProfile entry of the running Task and a semaphore
+Input: Semaphore_Handle sem
+Output: SemProfile_T*- the entry, or NULL if it is not profiled.
+Algorithm: Row taskId() - 1 (none for a Task without an ID), column
+		   semProfileSem.
+---------------------------------------------------------------------------*/
+static SemProfile_T *semProfileCell(Semaphore_Handle sem)
+{
+	Int col = semProfileSem(sem);
+	Int row = taskId() - 1;
+
+	if(row < 0 || col < 0)
+		return NULL;
+	return &semProfile[row][col];
+}
+
+/*---------------------------------------------------------------------------
+Function name: semProfiledPend
+Description: Semaphore_pend with wait accounting
+Input: Semaphore_Handle sem, UInt32 timeout
+Output: Bool- as Semaphore_pend.
+Algorithm: Try to take the semaphore without waiting. If that fails (and
+		   the caller may wait), time a blocking Semaphore_pend.
 ---------------------------------------------------------------------------*/
-Bool insert_item(Int item)
+Bool semProfiledPend(Semaphore_Handle sem, UInt32 timeout)
 {
-	Semaphore_pend(emptySlots, BIOS_WAIT_FOREVER);
-	Semaphore_pend(mutex, BIOS_WAIT_FOREVER);
-	if(buffer[in] != EMPTY_SLOT_IND)
+	SemProfile_T *cell = semProfileCell(sem);
+	UInt32 start, waited;
+	Bool acquired;
+
+	if(Semaphore_pend(sem, BIOS_NO_WAIT))
 	{
-		printErrorMessage("insert_item:: Error, could not insert item %u!", item);
-		Semaphore_post(mutex);
-		Semaphore_post(emptySlots);
+		if(cell != NULL)
+			cell->acquired++;
+		return TRUE;
+	}
+	if(timeout == BIOS_NO_WAIT)
+	{
+		if(cell != NULL)
+			cell->failed++;
 		return FALSE;
 	}
-	count = -~count;
-	buffer[in] = item;
-	in = -~in % BUFFER_SIZE;
-	printMessage("Produced item value = %u; Count = %u", item, count);
-	Semaphore_post(mutex);
-	Semaphore_post(fullSlots);
+	start = Timestamp_get32();
+	acquired = Semaphore_pend(sem, timeout);
+	waited = Timestamp_get32() - start;
+	if(cell != NULL)
+	{
+		if(acquired)
+		{
+			cell->acquired++;
+			cell->blocked++;
+		}
+		else
+			cell->failed++;
+		cell->waitTotal += waited;
+		if(waited > cell->waitMax)
+			cell->waitMax = waited;
+	}
+	return acquired;
+}
+
+/*---------------------------------------------------------------------------
+Function name: semProfiledPost
+Description: Semaphore_post with accounting
+Input: Semaphore_Handle sem
+Output: None
+Algorithm: Count the post, then post.
+---------------------------------------------------------------------------*/
+void semProfiledPost(Semaphore_Handle sem)
+{
+	SemProfile_T *cell = semProfileCell(sem);
+	if(cell != NULL)
+		cell->posts++;
+	Semaphore_post(sem);
+}
+
+/*---------------------------------------------------------------------------
+Function name: semProfileEntry
+Description: Export one semProfile entry
+Input: Int row, Int sem, Task_Handle *task, String *semName, SemProfile_T *entry
+Output: Bool- False if there is no such row/semaphore.
+Algorithm: Range check, then copy.
+---------------------------------------------------------------------------*/
+Bool semProfileEntry(Int row, Int sem, Task_Handle *task, String *semName, SemProfile_T *entry)
+{
+	static const String names[SEM_PROFILE_SEMS] = {
+		"emptySlots", "fullSlots", "mutex", "setLedEnvMutex", "ledSrvSchedSem", "ledBlinkDoneSem"
+	};
+	Int rows = statsTaskCount;
+
+	if(row < 0 || row >= rows || row >= STATS_TASKS || sem < 0 || sem >= SEM_PROFILE_SEMS)
+		return FALSE;
+	*task = statsRows[row].task;
+	*semName = names[sem];
+	*entry = semProfile[row][sem];
 	return TRUE;
 }
 
 /*---------------------------------------------------------------------------
-Function name: remove_item
-Description: Removes an item from the buffer
-Input: Int *item
-Output: Bool- True if an item was removed, False if not.
-Algorithm: Wait until there are items in the buffer, then check if the next
-		   place is not empty, if it's not- it removes the item, reduce count,
-		   advance "out" variable and issue a log message, then signals the
-		   producers.
+Function name: semProfileDump
+Description: Log the semaphore wait profile
+Input: None
+Output: None
+Algorithm: Log every entry with any pend or post, four lines each.
+---------------------------------------------------------------------------*/
+void semProfileDump(void)
+{
+	Task_Handle task;
+	String semName;
+	SemProfile_T entry;
+	Int row, sem;
+
+	for(row = 0; row < STATS_TASKS; row++)
+		for(sem = 0; sem < SEM_PROFILE_SEMS; sem++)
+		{
+			if(!semProfileEntry(row, sem, &task, &semName, &entry))
+				continue;
+			if(entry.acquired + entry.failed + entry.posts == 0)
+				continue;
+			Log_info2("SemProfile: Task = %s; Semaphore = %s", (IArg)Task_Handle_name(task), (IArg)semName);
+			Log_info2("SemProfile: acquired = %u; blocked = %u", entry.acquired, entry.blocked);
+			Log_info2("SemProfile: failed = %u; posts = %u", entry.failed, entry.posts);
+			Log_info2("SemProfile: avg wait = %u; max wait = %u",
+					  entry.blocked ? (UInt32)(entry.waitTotal / entry.blocked) : 0, entry.waitMax);
+		}
+}
+#endif
+
+/*---------------------------------------------------------------------------
+Function name: taskId
+Description: ID of the running Task
+Input: None
+Output: Int- statsRows row + 1, or 0 if statsRows is full.
+Algorithm: The Task's Env holds the ID. On the first call, claim the next
+		   row (compare-and-swap on statsTaskCount), record the Task in it and
+		   set the Env; a Task which finds the table full is counted in
+		   statsUntracked and gets STATS_TASKS + 1 in its Env. No tracing
+		   here: traceEvent calls taskId.
 ---------------------------------------------------------------------------*/
-Bool remove_item(Int *item)
+Int taskId(void)
 {
-	Semaphore_pend(fullSlots, BIOS_WAIT_FOREVER);
-	Semaphore_pend(mutex, BIOS_WAIT_FOREVER);
-	if(buffer[out] == EMPTY_SLOT_IND)
+	Task_Handle self = Task_self();
+	Int id = (Int)(UArg)Task_getEnv(self);
+	Int row;
+
+	if(id == 0)
 	{
-		printErrorMessage("remove_item:: Error, could not consume item %u!", *item);
-		Semaphore_post(mutex);
-		Semaphore_post(fullSlots);
-		return FALSE;
+		do
+		{
+			row = statsTaskCount;
+		} while(row < STATS_TASKS && !atomicCompareExchange(&statsTaskCount, row, row + 1));
+		id = row + 1;
+		Task_setEnv(self, (Ptr)(UArg)id);
+		if(row < STATS_TASKS)
+			statsRows[row].task = self;
+		else
+		{
+			do
+			{
+				row = statsUntracked;
+			} while(!atomicCompareExchange(&statsUntracked, row, row + 1));
+		}
 	}
-	count--;
-	*item = buffer[out];
-	buffer[out] = EMPTY_SLOT_IND;
-	out = -~out % BUFFER_SIZE;
-	printMessage("Consumed item value = %u; Count = %u", *item, count);
-	Semaphore_post(mutex);
-	Semaphore_post(emptySlots);
+	return id <= STATS_TASKS ? id : 0;
+}
+
+/*---------------------------------------------------------------------------
+Function name: statsRegister
+Description: The statsRows row of the running Task
+Input: None
+Output: volatile StatsRow_T*- the row (statsScratch if the table is full).
+Algorithm: Row taskId() - 1. A Task which had no ID yet and finds the
+		   table full is traced once.
+---------------------------------------------------------------------------*/
+volatile StatsRow_T *statsRegister(void)
+{
+	Bool first = Task_getEnv(Task_self()) == NULL;
+	Int id = taskId();
+
+	if(id == 0)
+	{
+		if(first)
+			TRACE_ERROR(STATS_ERROR, STATS_TASKS, 0);
+		return &statsScratch;
+	}
+	return &statsRows[id - 1];
+}
+
+/*---------------------------------------------------------------------------
+Function name: statsAdd
+Description: Add to a counter of the running Task's row
+Input: volatile StatsRow_T *row, volatile UInt32 *counter, UInt32 n
+Output: None
+Algorithm: Sequence lock writer: make "seq" odd, store the counter, make
+		   "seq" even again. Release stores keep the three in that order for
+		   a reader on another core (host build).
+---------------------------------------------------------------------------*/
+void statsAdd(volatile StatsRow_T *row, volatile UInt32 *counter, UInt32 n)
+{
+	UInt seq = row->seq;
+
+	ATOMIC_STORE_RLX(&row->seq, seq + 1);
+	ATOMIC_STORE_REL(counter, *counter + n);
+	ATOMIC_STORE_REL(&row->seq, seq + 2);
+}
+
+/*---------------------------------------------------------------------------
+Function name: statsTaskSnapshot
+Description: Copy the counters of one statsRows row
+Input: Int row, Task_Handle *task, TaskStats_T *stats
+Output: Bool- False if there is no such row.
+Algorithm: Sequence lock reader: read "seq", copy the counters and read
+		   "seq" again; retry while it was odd or has changed.
+---------------------------------------------------------------------------*/
+Bool statsTaskSnapshot(Int row, Task_Handle *task, TaskStats_T *stats)
+{
+	volatile StatsRow_T *r;
+	UInt seq;
+
+	if(row < 0 || row >= statsTaskCount || row >= STATS_TASKS)
+		return FALSE;
+	r = &statsRows[row];
+	do
+	{
+		seq = ATOMIC_LOAD_ACQ(&r->seq);
+		stats->produced = ATOMIC_LOAD_ACQ(&r->counts.produced);
+		stats->consumed = ATOMIC_LOAD_ACQ(&r->counts.consumed);
+		stats->insertErrors = ATOMIC_LOAD_ACQ(&r->counts.insertErrors);
+		stats->removeErrors = ATOMIC_LOAD_ACQ(&r->counts.removeErrors);
+		stats->ledPosted = ATOMIC_LOAD_ACQ(&r->counts.ledPosted);
+		stats->ledServed = ATOMIC_LOAD_ACQ(&r->counts.ledServed);
+		stats->throttled = ATOMIC_LOAD_ACQ(&r->counts.throttled);
+		stats->shed = ATOMIC_LOAD_ACQ(&r->counts.shed);
+		stats->timeouts = ATOMIC_LOAD_ACQ(&r->counts.timeouts);
+		stats->deadlineMisses = ATOMIC_LOAD_ACQ(&r->counts.deadlineMisses);
+	} while((seq & 1) != 0 || ATOMIC_LOAD_RLX(&r->seq) != seq);
+	*task = r->task;
 	return TRUE;
 }
 
 /*---------------------------------------------------------------------------
-Function name: ledToggle
-Description: Blink LEDs
-Input: uint8_t selectedPort, uint16_t selectedPins, int times
+Function name: statsSnapshot
+Description: Sum the counters of all Tasks
+Input: StatsSnapshot_T *snapshot
 Output: None
-Algorithm: Runs in a while loop, toggle LED each iteration.
+Algorithm: Stamp the snapshot, then add up statsTaskSnapshot of every row.
 ---------------------------------------------------------------------------*/
-void ledToggle(uint8_t selectedPort, uint16_t selectedPins, int times)
+void statsSnapshot(StatsSnapshot_T *snapshot)
 {
-	times <<= 1;
-	while(times > 0)
+	Task_Handle task;
+	TaskStats_T row;
+	Int i;
+
+	snapshot->ticks = Clock_getTicks();
+	snapshot->timestamp = Timestamp_get32();
+	snapshot->total.produced = 0;
+	snapshot->total.consumed = 0;
+	snapshot->total.insertErrors = 0;
+	snapshot->total.removeErrors = 0;
+	snapshot->total.ledPosted = 0;
+	snapshot->total.ledServed = 0;
+	snapshot->total.throttled = 0;
+	snapshot->total.shed = 0;
+	snapshot->total.timeouts = 0;
+	snapshot->total.deadlineMisses = 0;
+	for(i = 0; statsTaskSnapshot(i, &task, &row); i++)
 	{
-		GPIO_toggleOutputOnPin(selectedPort, selectedPins);
-		delay();
-		times--;
+		snapshot->total.produced += row.produced;
+		snapshot->total.consumed += row.consumed;
+		snapshot->total.insertErrors += row.insertErrors;
+		snapshot->total.removeErrors += row.removeErrors;
+		snapshot->total.ledPosted += row.ledPosted;
+		snapshot->total.ledServed += row.ledServed;
+		snapshot->total.throttled += row.throttled;
+		snapshot->total.shed += row.shed;
+		snapshot->total.timeouts += row.timeouts;
+		snapshot->total.deadlineMisses += row.deadlineMisses;
 	}
+	snapshot->tasks = i;
+	snapshot->untracked = statsUntracked;
 }
 
 /*---------------------------------------------------------------------------
-Function name: printErrorMessage
-Description: Print log messages
-Input: char* errorMsg, Int msgArg1
+Function name: statsDump
+Description: Log the counters of all Tasks
+Input: None
 Output: None
-Algorithm: Use Log_info1 function to send a log message.
+Algorithm: Log a statsSnapshot, four lines (one more with BACKPRESSURE, one
+		   more with insert/remove timeouts).
 ---------------------------------------------------------------------------*/
-void printErrorMessage(char* errorMsg, Int msgArg1)
+void statsDump(void)
 {
-	Log_info1(errorMsg, msgArg1);
+	StatsSnapshot_T snapshot;
+
+	statsSnapshot(&snapshot);
+	Log_info2("Stats: ticks = %u; tasks = %u", snapshot.ticks, snapshot.tasks);
+	Log_info2("Stats: produced = %u; consumed = %u", snapshot.total.produced, snapshot.total.consumed);
+	Log_info2("Stats: insert errors = %u; remove errors = %u",
+			  snapshot.total.insertErrors, snapshot.total.removeErrors);
+	Log_info2("Stats: LED requests posted = %u; served = %u",
+			  snapshot.total.ledPosted, snapshot.total.ledServed);
+#if BACKPRESSURE != BACKPRESSURE_OFF
+	Log_info2("Stats: backpressure pauses = %u; items shed = %u",
+			  snapshot.total.throttled, snapshot.total.shed);
+#endif
+#if INSERT_TIMEOUT_TICKS > 0 || REMOVE_TIMEOUT_TICKS > 0
+	Log_info2("Stats: insert/remove timeouts = %u; deadline misses = %u",
+			  snapshot.total.timeouts, snapshot.total.deadlineMisses);
+#endif
 }
 
+#if TIME_SLICE == TIME_SLICE_ADAPTIVE
 /*---------------------------------------------------------------------------
-Function name: printMessage
-Description: Print log messages
-Input: char* msg, Int msgArg1, Int msgArg2
+Function name: timeSlicePeerReady
+Description: Is another Task of the same priority ready?
+Input: Task_Handle self, Int priority
+Output: Bool- True if a Task of statsRows other than self is ready at priority.
+Algorithm: Go round the statsRows rows starting at sliceHint (a row claimed
+		   but not yet filled in has no Task): skip self and the Tasks of
+		   another priority, and stop at the first one in Task_Mode_READY,
+		   remembering its row in sliceHint.
+---------------------------------------------------------------------------*/
+Bool timeSlicePeerReady(Task_Handle self, Int priority)
+{
+	Int count = statsTaskCount;
+	Task_Handle task;
+	Int i, row;
+
+	if(count > STATS_TASKS)
+		count = STATS_TASKS;
+	for(i = 0; i < count; i++)
+	{
+		row = sliceHint + i < count ? sliceHint + i : sliceHint + i - count;
+		task = statsRows[row].task;
+		if(task == NULL || task == self || Task_getPri(task) != priority)
+			continue;
+		if(Task_getMode(task) == Task_Mode_READY)
+		{
+			sliceHint = row;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/*---------------------------------------------------------------------------
+Function name: timeSliceSnapshot
+Description: Copy the time slicing figures of one statsRows row
+Input: Int row, TimeSlice_T *slice
+Output: Bool- False if there is no such row.
+Algorithm: tsClockHandler writes the figures from the Clock Swi, so copy
+		   them with interrupts disabled on the target (a 32 bit counter is
+		   two words); on the host every counter is a single atomic load.
+---------------------------------------------------------------------------*/
+Bool timeSliceSnapshot(Int row, TimeSlice_T *slice)
+{
+	volatile TimeSlice_T *s;
+#if defined(__TI_COMPILER_VERSION__)
+	UInt key;
+#endif
+
+	if(row < 0 || row >= statsTaskCount || row >= STATS_TASKS)
+		return FALSE;
+	s = &timeSlice[row];
+#if defined(__TI_COMPILER_VERSION__)
+	key = Hwi_disable();
+#endif
+	slice->ticks = ATOMIC_LOAD_RLX(&s->ticks);
+	slice->yields = ATOMIC_LOAD_RLX(&s->yields);
+	slice->kept = ATOMIC_LOAD_RLX(&s->kept);
+#if defined(__TI_COMPILER_VERSION__)
+	Hwi_restore(key);
+#endif
+	return TRUE;
+}
+#endif
+
+/*---------------------------------------------------------------------------
+Function name: traceEvent
+Description: Report a trace event
+Input: TraceEvent_E event, Int arg1, Int arg2
 Output: None
-Algorithm: Use Log_info2 function to send a log message.
+Algorithm: TRACE_SINK_LOG: Log_info2 of the event's format. TRACE_SINK_RING:
+		   fill the record at traceBuffer.head and advance it - with interrupts
+		   disabled on the target (a Task switch in between would hand the
+		   same record to two Tasks), with an atomic increment of the head on
+		   the host.
+---------------------------------------------------------------------------*/
+void traceEvent(TraceEvent_E event, Int arg1, Int arg2)
+{
+#if TRACE_SINK == TRACE_SINK_LOG
+	Log_info2(traceFormats[event], arg1, arg2);
+#elif TRACE_SINK == TRACE_SINK_RING
+	Int task = taskId();
+	TraceRecord_T *record;
+#if defined(__TI_COMPILER_VERSION__)
+	UInt key = Hwi_disable();
+	record = &traceBuffer.records[(UInt)traceBuffer.head & (TRACE_RING_SIZE - 1)];
+	record->timestamp = Timestamp_get32();
+	record->arg1 = (UInt16)arg1;
+	record->arg2 = (UInt16)arg2;
+	record->event = (UInt8)event;
+	record->task = (UInt8)task;
+	traceBuffer.head++;
+	Hwi_restore(key);
+#else
+	UInt32 head = __atomic_fetch_add(&traceBuffer.head, 1, __ATOMIC_RELAXED);
+	record = &traceBuffer.records[head & (TRACE_RING_SIZE - 1)];
+	record->timestamp = Timestamp_get32();
+	record->arg1 = (UInt16)arg1;
+	record->arg2 = (UInt16)arg2;
+	record->event = (UInt8)event;
+	record->task = (UInt8)task;
+#endif
+#endif
+}
+
+/*---------------------------------------------------------------------------
+Function name: traceSetMask
+Description: Choose the trace categories to report
+Input: UInt mask
+Output: UInt- the previous mask.
+Algorithm: Swap traceMask.
 ---------------------------------------------------------------------------*/
-void printMessage(char* msg, Int msgArg1, Int msgArg2)
+UInt traceSetMask(UInt mask)
 {
-	Log_info2(msg, msgArg1, msgArg2);
+	UInt old = traceMask;
+	traceMask = mask;
+	return old;
+}
+
+#if TRACE_SINK == TRACE_SINK_RING
+/*---------------------------------------------------------------------------
+Function name: traceEntry
+Description: Export one record of the trace ring
+Input: UInt32 index, TraceRecord_T *record
+Output: Bool- False if there is no such record.
+Algorithm: The ring keeps the last min(head, TRACE_RING_SIZE) records; the
+		   oldest of them is number head - kept.
+---------------------------------------------------------------------------*/
+Bool traceEntry(UInt32 index, TraceRecord_T *record)
+{
+	UInt32 head = traceBuffer.head;
+	UInt32 kept = head < TRACE_RING_SIZE ? head : TRACE_RING_SIZE;
+
+	if(index >= kept)
+		return FALSE;
+	*record = traceBuffer.records[(head - kept + index) & (TRACE_RING_SIZE - 1)];
+	return TRUE;
 }
+#endif
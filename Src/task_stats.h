@@ -0,0 +1,70 @@
+/*
+ task_stats.h
+
+ The per-Task counters of main.c (see statsRows) as their readers see them: the counter and
+ snapshot types and the two functions which copy them out. main.c includes it, and so does the
+ host report (host/empty_cfg.c), so that both always agree on the layouts. Include it after
+ <xdc/std.h> and the Task module (Task_Handle).
+ */
+#ifndef TASK_STATS_H
+#define TASK_STATS_H
+
+/*
+ TaskStats_T - the counters of one Task (or their sum over all Tasks): items it inserted/
+ removed, insert_item/remove_item calls which failed, LED requests it handed to prepForLedSrv
+ and (ledSrvTask) LED requests it blinked, (producers, see BACKPRESSURE) the pauses it took
+ and the items it dropped under backpressure, and the insert_item_timeout/remove_item_timeout
+ calls which timed out or missed their deadline. All counters only ever grow (modulo 2^32), so
+ the difference of two snapshots is the work done in between.
+ */
+typedef struct
+{
+	UInt32 produced;
+	UInt32 consumed;
+	UInt32 insertErrors;
+	UInt32 removeErrors;
+	UInt32 ledPosted;
+	UInt32 ledServed;
+	UInt32 throttled;
+	UInt32 shed;
+	UInt32 timeouts;
+	UInt32 deadlineMisses;
+}TaskStats_T;
+
+/*
+ StatsSnapshot_T - the result of statsSnapshot: when it was taken (Clock ticks and
+ Timestamp_get32()), the counters summed over all Tasks, the number of Tasks counted and the
+ number of Tasks which found statsRows full (and are not counted).
+
+ E.g. a monitor Task computes the consumed items/sec between two snapshots "a" and "b" as
+ (b.total.consumed - a.total.consumed) * 1000000 / ((b.ticks - a.ticks) * Clock_tickPeriod),
+ and the insert error rate as the difference of insertErrors over that of produced.
+ */
+typedef struct
+{
+	UInt32 ticks;
+	UInt32 timestamp;
+	TaskStats_T total;
+	Int tasks;
+	Int untracked;
+}StatsSnapshot_T;
+
+/*
+ Function: Bool statsTaskSnapshot(Int row, Task_Handle *task, TaskStats_T *stats)
+
+ Copies the counters of row "row" (0 to the number of counted Tasks - 1), with its Task.
+ Returns FALSE if there is no such row - used to export the per-Task figures.
+ */
+Bool statsTaskSnapshot(Int row, Task_Handle *task, TaskStats_T *stats);
+
+/*
+ Function: void statsSnapshot(StatsSnapshot_T *snapshot)
+
+ Sums the counters of all Tasks into *snapshot (see StatsSnapshot_T). Never blocks
+ producers/consumers; every row is consistent in itself, but the rows are copied one after
+ the other, so a row may be a moment newer than the one before it (e.g. consumed may
+ briefly exceed produced by the items of a single batch).
+ */
+void statsSnapshot(StatsSnapshot_T *snapshot);
+
+#endif
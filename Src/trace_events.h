@@ -0,0 +1,36 @@
+/*
+ trace_events.h
+
+ The trace events of main.c (see TRACE_AT/traceEvent), one TRACE_EVENT(name, level, category,
+ format) line each: "name" becomes TRACE_<name> of TraceEvent_E; "level" (DEBUG, INFO or
+ ERROR) and "category" (DATA - the buffer data path, LED - the LED service, SYS - the rest)
+ decide whether the event is compiled in (TRACE_LEVEL) and reported (traceMask); "format" is
+ the Log message the event stands for, with its two arguments (arg1, arg2 - unused ones are 0).
+ main.c raises an event with the macro of its level (TRACE_DEBUG, TRACE_INFO, TRACE_ERROR).
+
+ The list is expanded wherever a table per event is needed - the event enum, levels,
+ categories and Log formats in main.c, and the formats of the host decoder
+ (host/trace_decode.c) - so an event is added in one place only. Append new events at the
+ end: the event number is what is stored in the trace ring, and old dumps should still decode.
+ */
+
+TRACE_EVENT(PRODUCED, DEBUG, DATA, "Produced item value = %u; Count = %u")
+TRACE_EVENT(CONSUMED, DEBUG, DATA, "Consumed item value = %u; Count = %u")
+TRACE_EVENT(PRODUCER_ITEM, DEBUG, DATA, "ProducerID = %u; Produced Item = %u")
+TRACE_EVENT(CONSUMER_ITEM, DEBUG, DATA, "ConsumerID = %u; Removed Item = %u")
+TRACE_EVENT(INSERT_ERROR, ERROR, DATA, "insert_item:: Error, could not insert item %u!")
+TRACE_EVENT(REMOVE_ERROR, ERROR, DATA, "remove_item:: Error, could not consume an item - the next slot is empty!")
+TRACE_EVENT(INSERT_ITEMS_ERROR, ERROR, DATA, "insert_items:: Error, could not insert item %u!")
+TRACE_EVENT(REMOVE_ITEMS_ERROR, ERROR, DATA, "remove_items:: Error, could not consume item at slot %u!")
+TRACE_EVENT(PRODUCER_ERROR, ERROR, DATA, "ProducerID = %u:: Error, could not insert item!")
+TRACE_EVENT(CONSUMER_ERROR, ERROR, DATA, "ConsumerID = %u:: Error, could not remove item!")
+TRACE_EVENT(PRODUCER_SPSC_ERROR, ERROR, SYS, "ProducerID = %u:: Error, SPSC buffer supports producerTask1 only!")
+TRACE_EVENT(CONSUMER_SPSC_ERROR, ERROR, SYS, "ConsumerID = %u:: Error, SPSC buffer supports consumerTask1 only!")
+TRACE_EVENT(STATS_ERROR, ERROR, SYS, "statsRegister:: Error, no statsRows row left (STATS_TASKS = %u)!")
+TRACE_EVENT(LED_BLINK, DEBUG, LED, "ledSrvTask: LED = %u; Blinks = %u")
+TRACE_EVENT(LED_DROPPED, INFO, LED, "prepForLedSrv: LED queue full, request dropped (LED = %u; Blinks = %u)")
+TRACE_EVENT(BACKPRESSURE_ON, INFO, DATA, "Backpressure on: Count = %u; high watermark = %u")
+TRACE_EVENT(BACKPRESSURE_OFF, INFO, DATA, "Backpressure off: Count = %u; low watermark = %u")
+TRACE_EVENT(DEADLINE_MISS, INFO, DATA, "Deadline missed by %u ticks (timeout = %u ticks)")
+TRACE_EVENT(PRODUCER_TIMEOUT, INFO, DATA, "ProducerID = %u:: insert timed out, item %u dropped")
+TRACE_EVENT(CONSUMER_TIMEOUT, INFO, DATA, "ConsumerID = %u:: remove timed out")